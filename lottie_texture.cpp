@@ -0,0 +1,258 @@
+/*************************************************************************/
+/*  lottie_texture.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "lottie_texture.h"
+
+#include "core/os/file_access.h"
+#include "servers/visual_server.h"
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#include "thirdparty/rlottie/inc/rlottie.h"
+
+void LottieTexture::_update_size() {
+	int new_width = 0;
+	int new_height = 0;
+	if (lottie) {
+		size_t lottie_width = 0;
+		size_t lottie_height = 0;
+		lottie->size(lottie_width, lottie_height);
+		new_width = render_size.width > 0 ? int(render_size.width) : int(lottie_width);
+		new_height = render_size.height > 0 ? int(render_size.height) : int(lottie_height);
+	}
+	rendered_frame = -1;
+	if (new_width == width && new_height == height) {
+		return;
+	}
+	width = new_width;
+	height = new_height;
+	pixels = PoolByteArray();
+	if (width > 0 && height > 0) {
+		pixels.resize(width * height * 4);
+		VisualServer::get_singleton()->texture_allocate(texture, width, height, 0, Image::FORMAT_RGBA8, VS::TEXTURE_TYPE_2D, flags);
+	}
+	emit_changed();
+}
+
+void LottieTexture::_render_frame() {
+	if (!lottie || pixels.empty() || rendered_frame == frame) {
+		return;
+	}
+	{
+		PoolByteArray::Write write = pixels.write();
+		rlottie::Surface surface((uint32_t *)write.ptr(), width, height, width * 4);
+		surface.setFormat(rlottie::Surface::Format::ABGR32);
+		lottie->renderSync(frame, surface);
+	}
+	rendered_frame = frame;
+	Ref<Image> img;
+	img.instance();
+	img->create(width, height, false, Image::FORMAT_RGBA8, pixels);
+	VisualServer::get_singleton()->texture_set_data(texture, img);
+}
+
+Error LottieTexture::load_file(const String &p_path) {
+	FileAccess *file = FileAccess::open(p_path, FileAccess::READ);
+	ERR_FAIL_COND_V(!file, ERR_CANT_OPEN);
+	Vector<uint8_t> array;
+	array.resize(file->get_len());
+	file->get_buffer(array.ptrw(), array.size());
+	memdelete(file);
+	String file_json;
+	file_json.parse_utf8((const char *)array.ptr(), array.size());
+	set_json(file_json);
+	ERR_FAIL_COND_V(!lottie, ERR_PARSE_ERROR);
+	return OK;
+}
+
+void LottieTexture::_animation_changed() {
+	if (lottie) {
+		// Frames are usually set one after another by an animation, so the
+		// next one gets evaluated while the current one is drawn.
+		lottie->setPipelining(true);
+		frame = CLAMP(frame, 0, MAX(get_frame_count() - 1, 0));
+	}
+	_update_size();
+	_render_frame();
+}
+
+void LottieTexture::_load_json() {
+	model = PoolByteArray();
+	lottie.reset();
+	if (!json.empty()) {
+		CharString utf8 = json.utf8();
+		// Without a key the model is cached by content, textures holding the
+		// same JSON share it.
+		lottie = rlottie::Animation::loadFromData(utf8.get_data(), "");
+	}
+	if (lottie) {
+		// The resource saves the parsed model next to the JSON, loading it
+		// back skips the parser.
+		std::string serialized = lottie->serialize();
+		model.resize(serialized.size());
+		memcpy(model.write().ptr(), serialized.data(), serialized.size());
+	}
+	_animation_changed();
+	ERR_FAIL_COND(!json.empty() && !lottie);
+}
+
+void LottieTexture::set_json(const String &p_json) {
+	// A loaded resource restores the model first, the JSON it was made from
+	// follows and needs no parsing.
+	bool restored = lottie && json.empty() && model.size();
+	json = p_json;
+	if (restored && !json.empty()) {
+		return;
+	}
+	_load_json();
+}
+
+String LottieTexture::get_json() const {
+	return json;
+}
+
+void LottieTexture::set_model(const PoolByteArray &p_model) {
+	model = p_model;
+	lottie.reset();
+	if (model.size()) {
+		PoolByteArray::Read read = model.read();
+		lottie = rlottie::Animation::loadFromData(std::string((const char *)read.ptr(), model.size()), "");
+	}
+	// The model only loads with the rlottie version that wrote it, the JSON
+	// always does. Without the JSON yet, set_json() parses it once it comes.
+	if (!lottie && !json.empty()) {
+		_load_json();
+		return;
+	}
+	_animation_changed();
+}
+
+PoolByteArray LottieTexture::get_model() const {
+	return model;
+}
+
+void LottieTexture::set_frame(int p_frame) {
+	frame = MAX(p_frame, 0);
+	if (lottie) {
+		frame = MIN(frame, MAX(get_frame_count() - 1, 0));
+	}
+	_render_frame();
+}
+
+int LottieTexture::get_frame() const {
+	return frame;
+}
+
+int LottieTexture::get_frame_count() const {
+	return lottie ? int(lottie->totalFrame()) : 0;
+}
+
+float LottieTexture::get_frame_rate() const {
+	return lottie ? lottie->frameRate() : 0;
+}
+
+void LottieTexture::set_render_size(const Size2 &p_size) {
+	render_size = Size2(MAX(p_size.width, 0), MAX(p_size.height, 0));
+	_update_size();
+	_render_frame();
+}
+
+Size2 LottieTexture::get_render_size() const {
+	return render_size;
+}
+
+int LottieTexture::get_width() const {
+	return width;
+}
+
+int LottieTexture::get_height() const {
+	return height;
+}
+
+RID LottieTexture::get_rid() const {
+	return texture;
+}
+
+bool LottieTexture::has_alpha() const {
+	return true;
+}
+
+void LottieTexture::set_flags(uint32_t p_flags) {
+	flags = p_flags;
+	if (width > 0 && height > 0) {
+		VisualServer::get_singleton()->texture_set_flags(texture, flags);
+	}
+}
+
+uint32_t LottieTexture::get_flags() const {
+	return flags;
+}
+
+Ref<Image> LottieTexture::get_data() const {
+	if (pixels.empty() || rendered_frame == -1) {
+		return Ref<Image>();
+	}
+	Ref<Image> img;
+	img.instance();
+	img->create(width, height, false, Image::FORMAT_RGBA8, pixels);
+	return img;
+}
+
+void LottieTexture::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("load_file", "path"), &LottieTexture::load_file);
+	ClassDB::bind_method(D_METHOD("set_json", "json"), &LottieTexture::set_json);
+	ClassDB::bind_method(D_METHOD("get_json"), &LottieTexture::get_json);
+	ClassDB::bind_method(D_METHOD("set_model", "model"), &LottieTexture::set_model);
+	ClassDB::bind_method(D_METHOD("get_model"), &LottieTexture::get_model);
+	ClassDB::bind_method(D_METHOD("set_frame", "frame"), &LottieTexture::set_frame);
+	ClassDB::bind_method(D_METHOD("get_frame"), &LottieTexture::get_frame);
+	ClassDB::bind_method(D_METHOD("get_frame_count"), &LottieTexture::get_frame_count);
+	ClassDB::bind_method(D_METHOD("get_frame_rate"), &LottieTexture::get_frame_rate);
+	ClassDB::bind_method(D_METHOD("set_render_size", "size"), &LottieTexture::set_render_size);
+	ClassDB::bind_method(D_METHOD("get_render_size"), &LottieTexture::get_render_size);
+
+	// The model is a cache of the JSON, it comes first so that loading the
+	// resource restores it before the JSON is set.
+	ADD_PROPERTY(PropertyInfo(Variant::POOL_BYTE_ARRAY, "model", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NOEDITOR), "set_model", "get_model");
+	ADD_PROPERTY(PropertyInfo(Variant::STRING, "json", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NOEDITOR), "set_json", "get_json");
+	ADD_PROPERTY(PropertyInfo(Variant::VECTOR2, "render_size"), "set_render_size", "get_render_size");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "frame", PROPERTY_HINT_RANGE, "0,65536,1,or_greater"), "set_frame", "get_frame");
+}
+
+LottieTexture::LottieTexture() {
+	texture = VisualServer::get_singleton()->texture_create();
+}
+
+LottieTexture::~LottieTexture() {
+	VisualServer::get_singleton()->free(texture);
+}
@@ -0,0 +1,96 @@
+/*************************************************************************/
+/*  lottie_texture.h                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef LOTTIE_TEXTURE_H
+#define LOTTIE_TEXTURE_H
+
+#include "scene/resources/texture.h"
+
+#include <memory>
+
+namespace rlottie {
+class Animation;
+}
+
+// Texture backed by a live rlottie animation. Only the current frame is kept
+// in memory; it is rasterized again whenever the frame or size changes.
+class LottieTexture : public Texture {
+	GDCLASS(LottieTexture, Texture);
+
+	String json;
+	PoolByteArray model;
+	std::unique_ptr<rlottie::Animation> lottie;
+	RID texture;
+	PoolByteArray pixels;
+	Size2 render_size;
+	int width = 0;
+	int height = 0;
+	int frame = 0;
+	int rendered_frame = -1;
+	uint32_t flags = FLAG_FILTER;
+
+	void _animation_changed();
+	void _load_json();
+	void _update_size();
+	void _render_frame();
+
+protected:
+	static void _bind_methods();
+
+public:
+	Error load_file(const String &p_path);
+
+	void set_json(const String &p_json);
+	String get_json() const;
+
+	void set_model(const PoolByteArray &p_model);
+	PoolByteArray get_model() const;
+
+	void set_frame(int p_frame);
+	int get_frame() const;
+	int get_frame_count() const;
+	float get_frame_rate() const;
+
+	void set_render_size(const Size2 &p_size);
+	Size2 get_render_size() const;
+
+	virtual int get_width() const;
+	virtual int get_height() const;
+	virtual RID get_rid() const;
+	virtual bool has_alpha() const;
+	virtual void set_flags(uint32_t p_flags);
+	virtual uint32_t get_flags() const;
+	virtual Ref<Image> get_data() const;
+
+	LottieTexture();
+	~LottieTexture();
+};
+
+#endif // LOTTIE_TEXTURE_H
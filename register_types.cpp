@@ -30,12 +30,33 @@
 
 #include "register_types.h"
 #include "core/io/resource_importer.h"
+#include "core/project_settings.h"
+#include "lottie_texture.h"
 #include "resource_importer_lottie.h"
 
+#include "thirdparty/rlottie/inc/rlottie.h"
+
 void register_lottie_types() {
+	// rlottie shares one pool between all the animations and imports, 0 uses one thread per core.
+	int thread_count = GLOBAL_DEF("rendering/lottie/thread_count", 0);
+	ProjectSettings::get_singleton()->set_custom_property_info("rendering/lottie/thread_count", PropertyInfo(Variant::INT, "rendering/lottie/thread_count", PROPERTY_HINT_RANGE, "0,256,1"));
+	rlottie::configureThreadPool(MAX(thread_count, 0));
+
+	// Parsed models are cached by a hash of their content, so identical
+	// animations share one model and a reimported file never gets the model of
+	// its previous version. A budget of 0 bounds the cache by entry count only.
+	int cache_budget_mb = GLOBAL_DEF("rendering/lottie/model_cache_budget_mb", 0);
+	ProjectSettings::get_singleton()->set_custom_property_info("rendering/lottie/model_cache_budget_mb", PropertyInfo(Variant::INT, "rendering/lottie/model_cache_budget_mb", PROPERTY_HINT_RANGE, "0,4096,1,or_greater"));
+	rlottie::configureModelCacheKey(rlottie::ModelCacheKey::Content);
+	if (cache_budget_mb > 0) {
+		rlottie::configureModelCacheBudget(size_t(cache_budget_mb) << 20);
+	}
+
 	Ref<ResourceImporterLottie> lottie_sprite_animation;
 	lottie_sprite_animation.instance();
 	ResourceFormatImporter::get_singleton()->add_importer(lottie_sprite_animation);
+
+	ClassDB::register_class<LottieTexture>();
 }
 
 void unregister_lottie_types() {
@@ -31,7 +31,12 @@
 #include "resource_importer_lottie.h"
 
 #include "core/bind/core_bind.h"
+#include "core/hashfuncs.h"
 #include "core/io/file_access_pack.h"
+#include "core/io/json.h"
+#include "core/math/geometry.h"
+#include "core/os/os.h"
+#include "core/project_settings.h"
 #include "scene/2d/animated_sprite.h"
 #include "scene/2d/sprite.h"
 #include "scene/3d/sprite_3d.h"
@@ -61,9 +66,20 @@ void ResourceImporterLottie::get_import_options(List<ImportOption> *r_options, i
 	r_options->push_back(ImportOption(PropertyInfo(Variant::VECTOR2, "scale"), Vector2(1.0f, 1.0f)));
 	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "animation/import"), true));
 	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "animation/begin_playing"), true));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "atlas/enable"), false));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::INT, "atlas/max_page_size", PROPERTY_HINT_RANGE, "256,16384,1"), 4096));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "atlas/trim"), true));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "mipmaps/generate"), false));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "profiling/report"), false));
 }
 
 bool ResourceImporterLottie::get_option_visibility(const String &p_option, const Map<StringName, Variant> &p_options) const {
+	if (p_option.begins_with("atlas/") && p_option != "atlas/enable") {
+		return p_options["atlas/enable"];
+	}
+	if (p_option == "mipmaps/generate") {
+		return !p_options["atlas/enable"];
+	}
 	return true;
 }
 
@@ -91,16 +107,203 @@ int ResourceImporterLottie::get_preset_count() const {
 	return 0;
 }
 
+// Render target reused for every frame a job renders at one mip level. Pixels
+// outside dirty_rect, what the last render touched, are transparent.
+struct LottieFrameTarget {
+	Vector<uint32_t> buffer;
+	Size2i size;
+	Rect2 dirty_rect;
+};
+
+struct LottieFrameJob {
+	std::unique_ptr<rlottie::Animation> lottie;
+	std::future<rlottie::Surface> rendered;
+	std::vector<LottieFrameTarget> targets;
+	int level = 0;
+};
+
+struct LottieAtlasFrame {
+	PoolByteArray pixels;
+	Rect2 used_rect;
+	uint32_t hash = 0;
+};
+
+struct LottieAtlasPage {
+	Vector<int> frames;
+	Vector<Point2i> positions;
+	Size2i size;
+};
+
+static const int LOTTIE_ATLAS_PADDING = 1;
+
+// Queues p_frame on the job, rendered at mip level p_level (natively, from the
+// vectors) as straight alpha RGBA (what Image::FORMAT_RGBA8 expects) into the
+// job buffer of that level. Only the area the previous frame touched is
+// cleared.
+static void _render_frame_job(LottieFrameJob &r_job, int32_t p_frame, int p_level, const Vector<Size2i> &p_level_sizes) {
+	if (r_job.targets.empty()) {
+		r_job.targets.resize(p_level_sizes.size());
+	}
+	LottieFrameTarget &target = r_job.targets[p_level];
+	if (target.buffer.empty()) {
+		target.size = p_level_sizes[p_level];
+		target.buffer.resize(target.size.width * target.size.height);
+		target.dirty_rect = Rect2(Point2(), target.size);
+	}
+	rlottie::Surface surface(target.buffer.ptrw(), target.size.width, target.size.height, target.size.width * 4);
+	surface.setFormat(rlottie::Surface::Format::ABGR32);
+	surface.setClearRegion(target.dirty_rect.position.x, target.dirty_rect.position.y, target.dirty_rect.size.width, target.dirty_rect.size.height);
+	r_job.level = p_level;
+	r_job.rendered = r_job.lottie->render(p_frame, surface);
+}
+
+static LottieFrameTarget &_collect_frame_job(LottieFrameJob &r_job) {
+	rlottie::Surface surface = r_job.rendered.get();
+	LottieFrameTarget &target = r_job.targets[r_job.level];
+	target.dirty_rect = Rect2(surface.dirtyRegionPosX(), surface.dirtyRegionPosY(), surface.dirtyRegionWidth(), surface.dirtyRegionHeight());
+	return target;
+}
+
+static bool _is_same_frame(const uint8_t *p_pixels, const Rect2 &p_dirty_rect, const uint8_t *p_other_pixels, const Rect2 &p_other_dirty_rect, int p_width) {
+	if (p_dirty_rect != p_other_dirty_rect) {
+		return false;
+	}
+	for (int y = p_dirty_rect.position.y; y < p_dirty_rect.position.y + p_dirty_rect.size.height; y++) {
+		int offset = (y * p_width + int(p_dirty_rect.position.x)) * 4;
+		if (memcmp(p_pixels + offset, p_other_pixels + offset, p_dirty_rect.size.width * 4)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Bounding rect of the pixels that are not fully transparent, a 1x1 rect for
+// an empty frame so it still owns a (transparent) region in the atlas. Only
+// p_dirty_rect is scanned, the rest of the frame is known to be transparent.
+static Rect2 _get_frame_used_rect(const uint8_t *p_pixels, int p_width, const Rect2 &p_dirty_rect) {
+	int min_x = INT_MAX, min_y = INT_MAX, max_x = -1, max_y = -1;
+	for (int y = p_dirty_rect.position.y; y < p_dirty_rect.position.y + p_dirty_rect.size.height; y++) {
+		const uint8_t *row = p_pixels + y * p_width * 4;
+		for (int x = p_dirty_rect.position.x; x < p_dirty_rect.position.x + p_dirty_rect.size.width; x++) {
+			if (!row[x * 4 + 3]) {
+				continue;
+			}
+			min_x = MIN(min_x, x);
+			max_x = MAX(max_x, x);
+			min_y = MIN(min_y, y);
+			max_y = y;
+		}
+	}
+	if (max_x < 0) {
+		return Rect2(0, 0, 1, 1);
+	}
+	return Rect2(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+}
+
+static PoolByteArray _crop_frame_pixels(const uint8_t *p_pixels, int p_width, const Rect2 &p_rect) {
+	int crop_width = p_rect.size.width;
+	int crop_height = p_rect.size.height;
+	PoolByteArray cropped;
+	cropped.resize(crop_width * crop_height * 4);
+	PoolByteArray::Write write = cropped.write();
+	for (int y = 0; y < crop_height; y++) {
+		const uint8_t *src = p_pixels + ((int(p_rect.position.y) + y) * p_width + int(p_rect.position.x)) * 4;
+		memcpy(write.ptr() + y * crop_width * 4, src, crop_width * 4);
+	}
+	return cropped;
+}
+
+// Sums the render stats of all jobs into the report stored as import metadata.
+// Render times are summed over the render threads, so they can add up to more
+// than the import took.
+static Dictionary _make_profile_report(const std::vector<LottieFrameJob> &p_jobs) {
+	rlottie::RenderStats total;
+	for (size_t job_i = 0; job_i < p_jobs.size(); job_i++) {
+		rlottie::RenderStats stats = p_jobs[job_i].lottie->renderStats();
+		total.parseTime += stats.parseTime;
+		total.updateTime += stats.updateTime;
+		total.rasterTime += stats.rasterTime;
+		total.paintTime += stats.paintTime;
+		total.convertTime += stats.convertTime;
+		total.frameCount += stats.frameCount;
+		total.spanCount += stats.spanCount;
+		total.maskCount += stats.maskCount;
+		total.matteCount += stats.matteCount;
+		total.layers.resize(stats.layers.size());
+		for (size_t layer_i = 0; layer_i < stats.layers.size(); layer_i++) {
+			rlottie::RenderStats::Layer &layer = total.layers[layer_i];
+			layer.name = stats.layers[layer_i].name;
+			layer.updateTime += stats.layers[layer_i].updateTime;
+			layer.renderTime += stats.layers[layer_i].renderTime;
+			layer.spanCount += stats.layers[layer_i].spanCount;
+			layer.maskCount += stats.layers[layer_i].maskCount;
+			layer.matteCount += stats.layers[layer_i].matteCount;
+		}
+	}
+	Dictionary report;
+	report["parse_msec"] = total.parseTime;
+	report["update_msec"] = total.updateTime;
+	report["raster_msec"] = total.rasterTime;
+	report["paint_msec"] = total.paintTime;
+	report["convert_msec"] = total.convertTime;
+	report["frames"] = (int64_t)total.frameCount;
+	report["spans"] = (int64_t)total.spanCount;
+	report["masks"] = (int64_t)total.maskCount;
+	report["mattes"] = (int64_t)total.matteCount;
+	rlottie::ModelCacheStats cache_stats = rlottie::modelCacheStats();
+	Dictionary cache_report;
+	cache_report["hits"] = (int64_t)cache_stats.hits;
+	cache_report["misses"] = (int64_t)cache_stats.misses;
+	cache_report["evictions"] = (int64_t)cache_stats.evictions;
+	cache_report["entries"] = (int64_t)cache_stats.entries;
+	cache_report["bytes"] = (int64_t)cache_stats.bytes;
+	report["model_cache"] = cache_report;
+	Array layers;
+	for (size_t layer_i = 0; layer_i < total.layers.size(); layer_i++) {
+		const rlottie::RenderStats::Layer &layer = total.layers[layer_i];
+		Dictionary layer_report;
+		layer_report["name"] = String::utf8(layer.name.c_str());
+		layer_report["update_msec"] = layer.updateTime;
+		layer_report["render_msec"] = layer.renderTime;
+		layer_report["spans"] = (int64_t)layer.spanCount;
+		layer_report["masks"] = (int64_t)layer.maskCount;
+		layer_report["mattes"] = (int64_t)layer.matteCount;
+		layers.push_back(layer_report);
+	}
+	report["layers"] = layers;
+	return report;
+}
+
+// Packs frames [p_from, p_to) on one page, halving the range until every page
+// fits in p_max_size (a single frame bigger than that gets a page of its own).
+static void _pack_atlas_pages(const Vector<Size2i> &p_sizes, int p_from, int p_to, int p_max_size, Vector<LottieAtlasPage> &r_pages) {
+	Vector<Size2i> sizes;
+	for (int i = p_from; i < p_to; i++) {
+		sizes.push_back(p_sizes[i] + Size2i(LOTTIE_ATLAS_PADDING * 2, LOTTIE_ATLAS_PADDING * 2));
+	}
+	LottieAtlasPage page;
+	Geometry::make_atlas(sizes, page.positions, page.size);
+	if ((page.size.width > p_max_size || page.size.height > p_max_size) && p_to - p_from > 1) {
+		int middle = (p_from + p_to) / 2;
+		_pack_atlas_pages(p_sizes, p_from, middle, p_max_size, r_pages);
+		_pack_atlas_pages(p_sizes, middle, p_to, p_max_size, r_pages);
+		return;
+	}
+	for (int i = p_from; i < p_to; i++) {
+		page.frames.push_back(i);
+	}
+	r_pages.push_back(page);
+}
+
 Error ResourceImporterLottie::import(const String &p_source_file, const String &p_save_path, const Map<StringName, Variant> &p_options, List<String> *r_platform_variants, List<String> *r_gen_files, Variant *r_metadata) {
-	FileAccess *file = FileAccess::create(FileAccess::ACCESS_RESOURCES);
-	String data;
-	//Backport code
-	//String data = file->get_file_as_string(p_source_file, &err);
-	Vector<uint8_t> array = file->get_file_as_array(p_source_file);
-	data.parse_utf8((const char *)array.ptr(), array.size());
-	//End backport code
+	uint64_t import_begin = OS::get_singleton()->get_ticks_usec();
+	uint64_t texture_usec = 0;
+	// rlottie maps the file and parses it in place, which saves reading it
+	// into a buffer first. The file may also hold a model written by
+	// Animation::serialize() rather than JSON.
+	CharString path = ProjectSettings::get_singleton()->globalize_path(p_source_file).utf8();
 	std::unique_ptr<rlottie::Animation> lottie =
-			rlottie::Animation::loadFromData(data.utf8().ptrw(), p_source_file.utf8().ptr());
+			rlottie::Animation::loadFromFile(path.get_data());
 	ERR_FAIL_COND_V(!lottie, FAILED);
 	size_t width = 0;
 	size_t height = 0;
@@ -119,54 +322,201 @@ Error ResourceImporterLottie::import(const String &p_source_file, const String &
 	String name = animations[0];
 	double_t skip_frames = p_options["skip_frames"];
 	frames->set_animation_speed(name, lottie->frameRate() / (1.0 + skip_frames));
-	Vector<Ref<ImageTexture> > image_textures;
-
-	int godot_frame_count = (int)(lottie->totalFrame() / (1.0 + skip_frames)) + 1;
-	image_textures.resize(godot_frame_count);
-	for (int32_t frame_godot = 0; frame_godot < godot_frame_count; frame_godot++) {
-		Ref<ImageTexture> tex;
-		tex.instance();
-		if (p_options["compress/lossy"]) {
-			tex->set_storage(ImageTexture::STORAGE_COMPRESS_LOSSY);
-		} else {
-			tex->set_storage(ImageTexture::STORAGE_COMPRESS_LOSSLESS);
-		}
-		ERR_CONTINUE(frame_godot >= image_textures.size());
-		image_textures.write[frame_godot] = tex;
+	ImageTexture::Storage storage = ImageTexture::STORAGE_COMPRESS_LOSSLESS;
+	if (p_options["compress/lossy"]) {
+		storage = ImageTexture::STORAGE_COMPRESS_LOSSY;
+	}
+	bool atlas = p_options["atlas/enable"];
+	bool atlas_trim = p_options["atlas/trim"];
+	// Mip levels follow Image's chain (halving down to 1x1), each rendered
+	// from the vectors rather than downsampled from the level above.
+	bool mipmaps = !atlas && p_options["mipmaps/generate"];
+	Vector<Size2i> level_sizes;
+	Vector<int> level_offsets;
+	int frame_byte_size = 0;
+	level_sizes.push_back(Size2i(width, height));
+	while (mipmaps && (level_sizes[level_sizes.size() - 1].width > 1 || level_sizes[level_sizes.size() - 1].height > 1)) {
+		Size2i size = level_sizes[level_sizes.size() - 1];
+		level_sizes.push_back(Size2i(MAX(1, size.width >> 1), MAX(1, size.height >> 1)));
 	}
+	for (int i = 0; i < level_sizes.size(); i++) {
+		level_offsets.push_back(frame_byte_size);
+		frame_byte_size += level_sizes[i].width * level_sizes[i].height * 4;
+	}
+	ERR_FAIL_COND_V(frame_byte_size != Image::get_image_data_size(width, height, Image::FORMAT_RGBA8, mipmaps), ERR_BUG);
+	Vector<LottieAtlasFrame> atlas_frames;
+	Vector<int> atlas_frame_indices;
+	// Hold keyframes and static stretches render to identical pixels, so each
+	// frame is compared against the previous one and reuses its texture. The
+	// atlas path gets the same from its duplicate frame lookup.
+	PoolByteArray previous_pixels;
+	Rect2 previous_dirty_rect;
+	Ref<ImageTexture> previous_texture;
 
+	// Resolve which lottie frame backs each godot frame up front, so the
+	// frames can be rendered out of order and still land in sequence.
+	Vector<int32_t> lottie_frames;
 	float unskipped = 0;
-	int32_t frame_godot = 0;
 	int32_t total_frame = MIN(lottie->totalFrame(), INT_MAX);
 	for (int32_t frame_lottie = 0; frame_lottie < total_frame; frame_lottie++) {
 		int skipped_frames = (int)floor(unskipped);
 		frame_lottie += skipped_frames;
 		unskipped -= skipped_frames;
+		lottie_frames.push_back(frame_lottie);
+		unskipped += skip_frames;
+	}
 
-		Vector<uint32_t> buffer;
-		buffer.resize(width * height);
-		rlottie::Surface surface(buffer.ptrw(), width, height, width * 4);
-		lottie->renderSync(frame_lottie, surface);
-		PoolByteArray pixels;
-		int32_t buffer_byte_size = buffer.size() * sizeof(uint32_t);
-		pixels.resize(buffer_byte_size);
-		PoolByteArray::Write pixel_write = pixels.write();
-		memcpy(pixel_write.ptr(), buffer.ptr(), buffer_byte_size);
-		uint8_t *ptr_pixel_write = pixel_write.ptr();
-		for (int32_t pixel_i = 0; pixel_i < pixels.size(); pixel_i += 4) {
-			SWAP(ptr_pixel_write[pixel_i + 2], ptr_pixel_write[pixel_i + 0]);
-		}
-		Ref<Image> img;
-		img.instance();
-		img->create((int)width, (int)height, false, Image::FORMAT_RGBA8, pixels);
-		Dictionary d = Engine::get_singleton()->get_version_info();
-		ERR_CONTINUE(frame_godot >= image_textures.size());
-		Ref<ImageTexture> tex = image_textures.write[frame_godot];
-		tex->create_from_image(img, ImageTexture::FLAG_REPEAT | ImageTexture::FLAG_FILTER);
-		frames->add_frame(name, tex);
+	// Every job owns an animation instance (they share the cached model) and
+	// render buffers, and renders passes (a frame at one mip level) on the
+	// rlottie render threads, while this thread collects the finished passes
+	// in order and hands the frames to the textures. The other instances are
+	// restored from the serialized model, so the JSON is parsed once even when
+	// the model cache is off or the model is over its budget.
+	int32_t level_count = level_sizes.size();
+	int32_t pass_count = lottie_frames.size() * level_count;
+	int32_t job_count = CLAMP(OS::get_singleton()->get_processor_count(), 1, MAX(pass_count, 1));
+	std::vector<LottieFrameJob> jobs(job_count);
+	std::string model = job_count > 1 ? lottie->serialize() : std::string();
+	jobs[0].lottie = std::move(lottie);
+	for (int32_t job_i = 1; job_i < job_count; job_i++) {
+		jobs[job_i].lottie = rlottie::Animation::loadFromData(model, "");
+		ERR_FAIL_COND_V(!jobs[job_i].lottie, FAILED);
+	}
+	bool profiling = p_options["profiling/report"];
+	for (int32_t job_i = 0; job_i < job_count && profiling; job_i++) {
+		jobs[job_i].lottie->setProfiling(true);
+	}
+	for (int32_t job_i = 0; job_i < job_count && job_i < pass_count; job_i++) {
+		_render_frame_job(jobs[job_i], lottie_frames[job_i / level_count], job_i % level_count, level_sizes);
+	}
 
-		unskipped += skip_frames;
-		frame_godot++;
+	PoolByteArray pixels;
+	bool held = false;
+	for (int32_t pass = 0; pass < pass_count; pass++) {
+		int32_t frame_godot = pass / level_count;
+		int level = pass % level_count;
+		LottieFrameJob &job = jobs[pass % job_count];
+		const LottieFrameTarget &target = _collect_frame_job(job);
+		const uint8_t *frame_pixels = (const uint8_t *)target.buffer.ptr();
+		if (atlas) {
+			LottieAtlasFrame atlas_frame;
+			atlas_frame.used_rect = Rect2(0, 0, width, height);
+			if (atlas_trim) {
+				atlas_frame.used_rect = _get_frame_used_rect(frame_pixels, width, target.dirty_rect);
+			}
+			atlas_frame.pixels = _crop_frame_pixels(frame_pixels, width, atlas_frame.used_rect);
+			PoolByteArray::Read read = atlas_frame.pixels.read();
+			atlas_frame.hash = hash_djb2_buffer(read.ptr(), atlas_frame.pixels.size());
+			int atlas_frame_i = -1;
+			for (int i = 0; i < atlas_frames.size(); i++) {
+				const LottieAtlasFrame &other = atlas_frames[i];
+				if (other.hash != atlas_frame.hash || other.used_rect != atlas_frame.used_rect) {
+					continue;
+				}
+				if (!memcmp(other.pixels.read().ptr(), read.ptr(), atlas_frame.pixels.size())) {
+					atlas_frame_i = i;
+					break;
+				}
+			}
+			if (atlas_frame_i == -1) {
+				atlas_frame_i = atlas_frames.size();
+				atlas_frames.push_back(atlas_frame);
+			}
+			atlas_frame_indices.push_back(atlas_frame_i);
+		} else {
+			if (level == 0) {
+				// The frame is a hold when its full size level matches.
+				held = frame_godot > 0 && _is_same_frame(frame_pixels, target.dirty_rect, previous_pixels.read().ptr(), previous_dirty_rect, width);
+				if (!held) {
+					// The image keeps its pixels, so this is the one per
+					// frame allocation.
+					pixels = PoolByteArray();
+					pixels.resize(frame_byte_size);
+					memset(pixels.write().ptr(), 0, frame_byte_size);
+					previous_dirty_rect = target.dirty_rect;
+				}
+			}
+			if (!held) {
+				// Only the dirty rows are copied over.
+				PoolByteArray::Write write = pixels.write();
+				uint8_t *level_pixels = write.ptr() + level_offsets[level];
+				for (int y = target.dirty_rect.position.y; y < target.dirty_rect.position.y + target.dirty_rect.size.height; y++) {
+					int offset = (y * target.size.width + int(target.dirty_rect.position.x)) * 4;
+					memcpy(level_pixels + offset, frame_pixels + offset, target.dirty_rect.size.width * 4);
+				}
+			}
+			if (level == level_count - 1) {
+				if (held) {
+					frames->add_frame(name, previous_texture);
+				} else {
+					Ref<Image> img;
+					img.instance();
+					img->create((int)width, (int)height, mipmaps, Image::FORMAT_RGBA8, pixels);
+					Ref<ImageTexture> tex;
+					tex.instance();
+					tex->set_storage(storage);
+					uint32_t flags = ImageTexture::FLAG_REPEAT | ImageTexture::FLAG_FILTER;
+					if (mipmaps) {
+						flags |= ImageTexture::FLAG_MIPMAPS;
+					}
+					uint64_t texture_begin = OS::get_singleton()->get_ticks_usec();
+					tex->create_from_image(img, flags);
+					texture_usec += OS::get_singleton()->get_ticks_usec() - texture_begin;
+					frames->add_frame(name, tex);
+					previous_pixels = pixels;
+					previous_texture = tex;
+				}
+			}
+		}
+		int32_t next_pass = pass + job_count;
+		if (next_pass < pass_count) {
+			_render_frame_job(job, lottie_frames[next_pass / level_count], next_pass % level_count, level_sizes);
+		}
+	}
+	if (atlas) {
+		Vector<Size2i> atlas_sizes;
+		for (int i = 0; i < atlas_frames.size(); i++) {
+			atlas_sizes.push_back(Size2i(atlas_frames[i].used_rect.size.width, atlas_frames[i].used_rect.size.height));
+		}
+		Vector<LottieAtlasPage> pages;
+		if (atlas_frames.size()) {
+			_pack_atlas_pages(atlas_sizes, 0, atlas_frames.size(), p_options["atlas/max_page_size"], pages);
+		}
+		Vector<Ref<Texture> > atlas_textures;
+		atlas_textures.resize(atlas_frames.size());
+		for (int page_i = 0; page_i < pages.size(); page_i++) {
+			const LottieAtlasPage &page = pages[page_i];
+			Ref<Image> page_img;
+			page_img.instance();
+			page_img->create(page.size.width, page.size.height, false, Image::FORMAT_RGBA8);
+			for (int i = 0; i < page.frames.size(); i++) {
+				const LottieAtlasFrame &atlas_frame = atlas_frames[page.frames[i]];
+				Ref<Image> frame_img;
+				frame_img.instance();
+				frame_img->create(atlas_frame.used_rect.size.width, atlas_frame.used_rect.size.height, false, Image::FORMAT_RGBA8, atlas_frame.pixels);
+				Point2 position = page.positions[i] + Point2i(LOTTIE_ATLAS_PADDING, LOTTIE_ATLAS_PADDING);
+				page_img->blit_rect(frame_img, Rect2(Point2(), atlas_frame.used_rect.size), position);
+			}
+			Ref<ImageTexture> page_tex;
+			page_tex.instance();
+			page_tex->set_storage(storage);
+			uint64_t texture_begin = OS::get_singleton()->get_ticks_usec();
+			page_tex->create_from_image(page_img, ImageTexture::FLAG_FILTER);
+			texture_usec += OS::get_singleton()->get_ticks_usec() - texture_begin;
+			for (int i = 0; i < page.frames.size(); i++) {
+				const LottieAtlasFrame &atlas_frame = atlas_frames[page.frames[i]];
+				Ref<AtlasTexture> tex;
+				tex.instance();
+				tex->set_atlas(page_tex);
+				tex->set_region(Rect2(page.positions[i] + Point2i(LOTTIE_ATLAS_PADDING, LOTTIE_ATLAS_PADDING), atlas_frame.used_rect.size));
+				tex->set_margin(Rect2(atlas_frame.used_rect.position, Size2(width, height) - atlas_frame.used_rect.size));
+				tex->set_filter_clip(true);
+				atlas_textures.write[page.frames[i]] = tex;
+			}
+		}
+		for (int i = 0; i < atlas_frame_indices.size(); i++) {
+			frames->add_frame(name, atlas_textures[atlas_frame_indices[i]]);
+		}
 	}
 	Node *root = nullptr;
 	if (p_options["3d"] && !p_options["animation/import"]) {
@@ -207,5 +557,19 @@ Error ResourceImporterLottie::import(const String &p_source_file, const String &
 	scene->pack(root);
 	String save_path = p_save_path + ".scn";
 	r_gen_files->push_back(save_path);
-	return ResourceSaver::save(save_path, scene);
+	// Texture compression happens while saving.
+	uint64_t save_begin = OS::get_singleton()->get_ticks_usec();
+	Error err = ResourceSaver::save(save_path, scene);
+	uint64_t save_end = OS::get_singleton()->get_ticks_usec();
+	if (profiling && r_metadata) {
+		Dictionary report = _make_profile_report(jobs);
+		report["texture_msec"] = texture_usec / 1000.0;
+		report["save_msec"] = (save_end - save_begin) / 1000.0;
+		report["total_msec"] = (save_end - import_begin) / 1000.0;
+		print_verbose(vformat("Lottie import profile of %s: %s", p_source_file, JSON::print(report)));
+		Dictionary metadata;
+		metadata["lottie_profile"] = report;
+		*r_metadata = metadata;
+	}
+	return err;
 }
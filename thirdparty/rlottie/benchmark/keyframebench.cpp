@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Keyframe lookup microbenchmark.
+ *
+ * Evaluates a property with a growing number of keyframes, with the front
+ * to back scan KeyFrames::value() used before and with its current lookup:
+ *   sequential  every frame in order, like playback.
+ *   random      frames in random order, like seeking or a scrubbed timeline.
+ *
+ *   keyframebench [evaluations]
+ *   keyframebench --corpus <dir> [layers] [frames]
+ *
+ * --corpus writes an animation keyframed on every frame, like exported
+ * motion capture, to measure whole frame updates with lottiebench.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "lottiemodel.h"
+
+using namespace rlottie::internal;
+
+namespace {
+
+using FloatFrames = model::KeyFrames<float, void>;
+
+// KeyFrames::value() before the lookup, scanning from the first frame.
+float scan(const FloatFrames &frames, int frameNo)
+{
+    const auto &list = frames.frames_;
+    if (list.front().start_ >= frameNo) return list.front().value_.start_;
+    if (list.back().end_ <= frameNo) return list.back().value_.end_;
+
+    for (const auto &keyFrame : list) {
+        if (frameNo >= keyFrame.start_ && frameNo < keyFrame.end_)
+            return keyFrame.value(frameNo);
+    }
+    return {};
+}
+
+float lookup(const FloatFrames &frames, int frameNo)
+{
+    return frames.value(frameNo);
+}
+
+template <typename Eval>
+double measure(const FloatFrames &frames, const std::vector<int> &order,
+               size_t evaluations, Eval eval)
+{
+    double best = 1e30;
+    float  sink = 0;
+    for (int pass = 0; pass < 5; pass++) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t done = 0; done < evaluations;) {
+            for (int frameNo : order) sink += eval(frames, frameNo);
+            done += order.size();
+        }
+        size_t count = std::max(evaluations, order.size());
+        best = std::min(best, std::chrono::duration<double, std::nano>(
+                                  std::chrono::steady_clock::now() - start)
+                                      .count() /
+                                  double(count));
+    }
+    if (sink == 1234.5f) printf(" ");
+    return best;
+}
+
+void report(size_t keyFrames, size_t evaluations, VInterpolator *interpolator)
+{
+    FloatFrames frames;
+    frames.frames_.resize(keyFrames);
+    for (size_t i = 0; i < keyFrames; i++) {
+        auto &frame = frames.frames_[i];
+        frame.start_ = float(i * 2);
+        frame.end_ = float(i * 2 + 2);
+        frame.interpolator_ = interpolator;
+        frame.value_.start_ = float(i % 7);
+        frame.value_.end_ = float((i + 1) % 7);
+    }
+
+    std::vector<int> sequential(keyFrames * 2);
+    for (size_t i = 0; i < sequential.size(); i++) sequential[i] = int(i);
+    std::vector<int> random = sequential;
+    std::shuffle(random.begin(), random.end(), std::mt19937(keyFrames));
+
+    printf("%9zu %12.1f %12.1f %12.1f %12.1f\n", keyFrames,
+           measure(frames, sequential, evaluations, scan),
+           measure(frames, sequential, evaluations, lookup),
+           measure(frames, random, evaluations, scan),
+           measure(frames, random, evaluations, lookup));
+}
+
+// a keyframe on every frame for the position, rotation and path of every
+// layer, with a bezier ease between them. The last keyframe only ends the
+// one before it, so it has no ease.
+bool writeCorpus(const std::string &dir, size_t layers, size_t frames)
+{
+    std::string path =
+        dir + "/keyframes_" + std::to_string(layers) + "x" +
+        std::to_string(frames) + ".json";
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        fprintf(stderr, "can't write %s\n", path.c_str());
+        return false;
+    }
+
+    auto ease = [frames](size_t f) {
+        return f == frames ? ""
+                           : ",\"i\":{\"x\":[0.4],\"y\":[1]},"
+                             "\"o\":{\"x\":[0.6],\"y\":[0]}";
+    };
+    out << "{\"v\":\"5.5.2\",\"fr\":30,\"ip\":0,\"op\":" << frames
+        << ",\"w\":512,\"h\":512,\"assets\":[],\"layers\":[";
+    for (size_t l = 0; l < layers; l++) {
+        if (l) out << ",";
+        out << "{\"ty\":4,\"ind\":" << l + 1 << ",\"ip\":0,\"op\":" << frames
+            << ",\"st\":0,\"ks\":{\"o\":{\"a\":0,\"k\":100},"
+            << "\"a\":{\"a\":0,\"k\":[0,0]},\"s\":{\"a\":0,\"k\":[100,100]},";
+
+        out << "\"p\":{\"a\":1,\"k\":[";
+        for (size_t f = 0; f <= frames; f++) {
+            double a = double(f + l * 7) * 0.05;
+            if (f) out << ",";
+            out << "{\"t\":" << f << ",\"s\":[" << 256 + 200 * std::sin(a)
+                << "," << 256 + 200 * std::cos(a * 1.3) << "]" << ease(f) << "}";
+        }
+        out << "]},\"r\":{\"a\":1,\"k\":[";
+        for (size_t f = 0; f <= frames; f++) {
+            if (f) out << ",";
+            out << "{\"t\":" << f << ",\"s\":[" << (f * 3 + l * 11) % 360
+                << "]" << ease(f) << "}";
+        }
+        out << "]}},\"shapes\":[{\"ty\":\"sh\",\"ks\":{\"a\":1,\"k\":[";
+        for (size_t f = 0; f <= frames; f++) {
+            double r = 10 + 8 * std::sin(double(f + l) * 0.2);
+            if (f) out << ",";
+            out << "{\"t\":" << f << ",\"s\":[{\"c\":true,\"i\":[[0,0],[0,0],"
+                << "[0,0],[0,0]],\"o\":[[0,0],[0,0],[0,0],[0,0]],\"v\":[[" << -r
+                << ",0],[0," << -r << "],[" << r << ",0],[0," << r << "]]}]"
+                << ease(f) << "}";
+        }
+        out << "]}},{\"ty\":\"fl\",\"c\":{\"a\":0,\"k\":[0.2,0.5,0.8,1]},"
+            << "\"o\":{\"a\":0,\"k\":100}}]}";
+    }
+    out << "]}";
+
+    printf("wrote %s\n", path.c_str());
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--corpus") {
+        if (argc < 3) {
+            fprintf(stderr,
+                    "usage: keyframebench --corpus <dir> [layers] [frames]\n");
+            return 1;
+        }
+        size_t layers = argc > 3 ? size_t(std::max(1l, atol(argv[3]))) : 100;
+        size_t frames = argc > 4 ? size_t(std::max(2l, atol(argv[4]))) : 600;
+        return writeCorpus(argv[2], layers, frames) ? 0 : 1;
+    }
+
+    size_t evaluations = 2000000;
+    if (argc > 1) evaluations = size_t(std::max(1l, atol(argv[1])));
+
+    VInterpolator interpolator(VPointF(0.6f, 0), VPointF(0.4f, 1));
+    printf("%9s %12s %12s %12s %12s\n", "keyframes", "seq scan ns",
+           "seq ns", "random scan", "random ns");
+    for (size_t keyFrames : {4, 32, 256, 2048})
+        report(keyFrames, evaluations, &interpolator);
+    return 0;
+}
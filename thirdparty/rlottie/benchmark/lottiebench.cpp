@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Headless renderer benchmark, independent of Godot.
+ *
+ * For every Lottie file of the corpus it reports the parse time, the per
+ * frame update/render latency percentiles, the throughput with several
+ * concurrent render streams and the peak RSS, as a table or as JSON for
+ * regression tracking.
+ *
+ *   lottiebench [options] <file.json | directory>...
+ */
+
+#include <rlottie.h>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+}
+
+struct Options {
+    std::vector<std::string> files;
+    std::vector<size_t>      streams;
+    size_t                   width{0};
+    size_t                   height{0};
+    size_t                   maxFrames{0};
+    size_t                   repeat{3};
+    unsigned                 poolThreads{0};
+    bool                     json{false};
+    bool                     pipelined{false};
+};
+
+struct Percentiles {
+    double p50{0};
+    double p90{0};
+    double p99{0};
+    double max{0};
+};
+
+struct Throughput {
+    size_t streams{0};
+    double fps{0};
+};
+
+struct Result {
+    std::string             file;
+    bool                    valid{false};
+    size_t                  width{0};
+    size_t                  height{0};
+    size_t                  frames{0};
+    double                  parseMs{0};
+    Percentiles             update;
+    Percentiles             render;
+    Percentiles             total;
+    std::vector<Throughput> throughput;
+    long                    peakRssKb{0};
+};
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: lottiebench [options] <file.json | directory>...\n"
+            "  -t, --streams LIST  concurrent render streams to measure\n"
+            "                      throughput with (default 1,2,4,<cores>)\n"
+            "  -s, --size WxH      render size (default: animation size)\n"
+            "  -f, --frames N      render at most N frames per file\n"
+            "  -r, --repeat N      parse passes, the best one is kept "
+            "(default 3)\n"
+            "  -p, --pool N        worker threads of the rlottie pool "
+            "(default: cores)\n"
+            "      --pipelined     evaluate the next frame while one is drawn\n"
+            "      --json          machine readable output\n");
+}
+
+bool endsWith(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void addPath(const std::string &path, std::vector<std::string> &files)
+{
+    DIR *dir = opendir(path.c_str());
+    if (!dir) {
+        files.push_back(path);
+        return;
+    }
+    std::vector<std::string> entries;
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (endsWith(name, ".json")) entries.push_back(path + "/" + name);
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    files.insert(files.end(), entries.begin(), entries.end());
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool        hasValue = i + 1 < argc;
+        if ((arg == "-t" || arg == "--streams") && hasValue) {
+            std::stringstream list(argv[++i]);
+            std::string       item;
+            while (std::getline(list, item, ',')) {
+                size_t count = strtoul(item.c_str(), nullptr, 10);
+                if (count) options.streams.push_back(count);
+            }
+        } else if ((arg == "-s" || arg == "--size") && hasValue) {
+            if (sscanf(argv[++i], "%zux%zu", &options.width, &options.height) !=
+                2)
+                return false;
+        } else if ((arg == "-f" || arg == "--frames") && hasValue) {
+            options.maxFrames = strtoul(argv[++i], nullptr, 10);
+        } else if ((arg == "-r" || arg == "--repeat") && hasValue) {
+            options.repeat = std::max<size_t>(1, strtoul(argv[++i], nullptr, 10));
+        } else if ((arg == "-p" || arg == "--pool") && hasValue) {
+            options.poolThreads = unsigned(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--pipelined") {
+            options.pipelined = true;
+        } else if (arg[0] == '-') {
+            return false;
+        } else {
+            addPath(arg, options.files);
+        }
+    }
+    if (options.streams.empty()) {
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t count = 1; count < cores; count *= 2)
+            options.streams.push_back(count);
+        options.streams.push_back(cores);
+    }
+    return !options.files.empty();
+}
+
+Percentiles percentiles(std::vector<double> samples)
+{
+    Percentiles result;
+    if (samples.empty()) return result;
+
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double p) {
+        size_t index = size_t(p * double(samples.size() - 1) + 0.5);
+        return samples[index];
+    };
+    result.p50 = at(0.5);
+    result.p90 = at(0.9);
+    result.p99 = at(0.99);
+    result.max = samples.back();
+    return result;
+}
+
+long peakRssKb()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) return 0;
+    return usage.ru_maxrss;
+}
+
+// every stream renders all frames through the async api, keeping one frame
+// in flight per stream like a player would.
+double measureThroughput(const std::string &data, const std::string &key,
+                         size_t streams, size_t frames, size_t width,
+                         size_t height, bool pipelined)
+{
+    std::vector<std::unique_ptr<rlottie::Animation>> animations;
+    std::vector<std::vector<uint32_t>>               buffers(streams);
+    std::vector<std::future<rlottie::Surface>>       pending(streams);
+    for (size_t i = 0; i < streams; i++) {
+        animations.push_back(rlottie::Animation::loadFromData(data, key));
+        animations.back()->setPipelining(pipelined);
+        buffers[i].resize(width * height);
+    }
+
+    auto start = Clock::now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (size_t i = 0; i < streams; i++) {
+            if (pending[i].valid()) pending[i].get();
+            rlottie::Surface surface(buffers[i].data(), width, height,
+                                     width * 4);
+            pending[i] = animations[i]->render(frame, surface);
+        }
+    }
+    for (auto &future : pending) {
+        if (future.valid()) future.get();
+    }
+    double ms = elapsedMs(start);
+    return ms > 0 ? double(streams * frames) * 1000.0 / ms : 0;
+}
+
+Result benchmark(const std::string &path, const Options &options)
+{
+    Result result;
+    result.file = path;
+
+    std::ifstream file(path);
+    if (!file) return result;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    std::string data = stream.str();
+
+    std::unique_ptr<rlottie::Animation> animation;
+    result.parseMs = -1;
+    for (size_t i = 0; i < options.repeat; i++) {
+        auto start = Clock::now();
+        animation = rlottie::Animation::loadFromData(data, "", "", false);
+        double ms = elapsedMs(start);
+        if (!animation) return result;
+        if (result.parseMs < 0 || ms < result.parseMs) result.parseMs = ms;
+    }
+
+    animation->size(result.width, result.height);
+    if (options.width && options.height) {
+        result.width = options.width;
+        result.height = options.height;
+    }
+    result.frames = animation->totalFrame();
+    if (options.maxFrames) result.frames = std::min(result.frames, options.maxFrames);
+    if (!result.width || !result.height || !result.frames) return result;
+
+    std::vector<uint32_t> buffer(result.width * result.height);
+    std::vector<double>   update, render, total;
+    animation->setProfiling(true);
+    animation->setPipelining(options.pipelined);
+    for (size_t frame = 0; frame < result.frames; frame++) {
+        animation->resetRenderStats();
+        rlottie::Surface surface(buffer.data(), result.width, result.height,
+                                 result.width * 4);
+        auto start = Clock::now();
+        animation->renderSync(frame, surface);
+        double ms = elapsedMs(start);
+        double updateMs = animation->renderStats().updateTime;
+        update.push_back(updateMs);
+        render.push_back(std::max(0.0, ms - updateMs));
+        total.push_back(ms);
+    }
+    result.update = percentiles(update);
+    result.render = percentiles(render);
+    result.total = percentiles(total);
+
+    for (size_t streams : options.streams) {
+        Throughput throughput;
+        throughput.streams = streams;
+        throughput.fps = measureThroughput(data, path, streams, result.frames,
+                                           result.width, result.height,
+                                           options.pipelined);
+        result.throughput.push_back(throughput);
+    }
+
+    result.peakRssKb = peakRssKb();
+    result.valid = true;
+    return result;
+}
+
+std::string jsonString(const std::string &str)
+{
+    std::string out = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+void printJson(const Percentiles &p)
+{
+    printf("{\"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+           p.p50, p.p90, p.p99, p.max);
+}
+
+void printJson(const std::vector<Result> &results)
+{
+    printf("{\n  \"files\": [");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        printf("%s\n    {\"file\": %s, \"valid\": %s", i ? "," : "",
+               jsonString(r.file).c_str(), r.valid ? "true" : "false");
+        if (r.valid) {
+            printf(", \"width\": %zu, \"height\": %zu, \"frames\": %zu, "
+                   "\"parse_ms\": %.4f",
+                   r.width, r.height, r.frames, r.parseMs);
+            printf(", \"update_ms\": ");
+            printJson(r.update);
+            printf(", \"render_ms\": ");
+            printJson(r.render);
+            printf(", \"frame_ms\": ");
+            printJson(r.total);
+            printf(", \"throughput_fps\": {");
+            for (size_t t = 0; t < r.throughput.size(); t++) {
+                printf("%s\"%zu\": %.2f", t ? ", " : "",
+                       r.throughput[t].streams, r.throughput[t].fps);
+            }
+            printf("}, \"peak_rss_kb\": %ld", r.peakRssKb);
+        }
+        printf("}");
+    }
+    printf("\n  ],\n  \"pool_threads\": %u,\n  \"peak_rss_kb\": %ld\n}\n",
+           rlottie::threadPoolSize(), peakRssKb());
+}
+
+void printTable(const Result &r)
+{
+    if (!r.valid) {
+        printf("%s: failed to load\n", r.file.c_str());
+        return;
+    }
+    printf("%s (%zux%zu, %zu frames)\n", r.file.c_str(), r.width, r.height,
+           r.frames);
+    printf("  parse     %9.3f ms\n", r.parseMs);
+    printf("  %-9s %9s %9s %9s %9s\n", "ms", "p50", "p90", "p99", "max");
+    printf("  update    %9.3f %9.3f %9.3f %9.3f\n", r.update.p50, r.update.p90,
+           r.update.p99, r.update.max);
+    printf("  render    %9.3f %9.3f %9.3f %9.3f\n", r.render.p50, r.render.p90,
+           r.render.p99, r.render.max);
+    printf("  frame     %9.3f %9.3f %9.3f %9.3f\n", r.total.p50, r.total.p90,
+           r.total.p99, r.total.max);
+    for (const auto &t : r.throughput)
+        printf("  %3zu stream%s %9.1f fps\n", t.streams,
+               t.streams == 1 ? " " : "s", t.fps);
+    printf("  peak rss  %9ld KB\n", r.peakRssKb);
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    rlottie::configureThreadPool(options.poolThreads);
+
+    std::vector<Result> results;
+    bool                failed = false;
+    for (const auto &file : options.files) {
+        results.push_back(benchmark(file, options));
+        failed |= !results.back().valid;
+        if (!options.json) printTable(results.back());
+    }
+    if (options.json) printJson(results);
+
+    return failed ? 2 : 0;
+}
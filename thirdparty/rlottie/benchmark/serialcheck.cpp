@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Round trip check of the binary model format.
+ *
+ * Every frame is rendered from the JSON and from its serialize() output and
+ * the pixels have to match, the serialized model has to serialize to the
+ * same bytes again. Without arguments it checks a built in animation using
+ * the shapes, masks, mattes and precomps the format stores.
+ *
+ *   serialcheck [file.json | directory]...
+ */
+
+#include <rlottie.h>
+
+#include <dirent.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *builtIn = R"({
+"v":"5.5.2","fr":30,"ip":0,"op":30,"w":128,"h":128,
+"assets":[{"id":"comp_0","layers":[
+  {"ty":4,"ind":1,"ip":0,"op":30,"st":0,
+   "ks":{"o":{"a":0,"k":100},"p":{"a":0,"k":[0,0]},"a":{"a":0,"k":[0,0]},
+         "s":{"a":0,"k":[100,100]},"r":{"a":0,"k":0}},
+   "shapes":[
+     {"ty":"el","d":1,"p":{"a":0,"k":[64,64]},"s":{"a":0,"k":[80,80]}},
+     {"ty":"gf","t":1,"s":{"a":0,"k":[24,24]},"e":{"a":0,"k":[104,104]},
+      "g":{"p":2,"k":{"a":0,"k":[0,1,0.8,0,1,0,0.2,1]}},"o":{"a":0,"k":100},
+      "r":1}]}]}],
+"layers":[
+  {"ty":4,"ind":1,"td":1,"ip":0,"op":30,"st":0,
+   "ks":{"o":{"a":0,"k":100},"p":{"a":0,"k":[0,0]},"a":{"a":0,"k":[0,0]},
+         "s":{"a":0,"k":[100,100]},"r":{"a":0,"k":0}},
+   "shapes":[
+     {"ty":"sh","ks":{"a":0,"k":{"c":true,"i":[[0,0],[0,0],[0,0]],
+      "o":[[0,0],[0,0],[0,0]],"v":[[8,120],[64,8],[120,120]]}}},
+     {"ty":"fl","c":{"a":0,"k":[1,1,1,1]},"o":{"a":0,"k":100},"r":1}]},
+  {"ty":4,"ind":2,"tt":1,"ip":0,"op":30,"st":0,
+   "ks":{"o":{"a":0,"k":100},"p":{"a":0,"k":[0,0]},"a":{"a":0,"k":[0,0]},
+         "s":{"a":0,"k":[100,100]},"r":{"a":0,"k":0}},
+   "shapes":[
+     {"ty":"gr","it":[
+       {"ty":"rc","d":1,"p":{"a":0,"k":[40,64]},"r":{"a":0,"k":6},
+        "s":{"a":1,"k":[{"t":0,"s":[20,30],"i":{"x":[0.5],"y":[1]},
+                         "o":{"x":[0.5],"y":[0]}},{"t":30,"s":[40,60]}]}},
+       {"ty":"fl","c":{"a":0,"k":[0.9,0.3,0.2,1]},"o":{"a":0,"k":100},"r":1},
+       {"ty":"rp","c":{"a":0,"k":3},"o":{"a":0,"k":0},"m":1,
+        "tr":{"ty":"tr","p":{"a":0,"k":[24,0]},"a":{"a":0,"k":[0,0]},
+              "s":{"a":0,"k":[100,100]},"r":{"a":0,"k":10},
+              "so":{"a":0,"k":100},"eo":{"a":0,"k":40}}},
+       {"ty":"tr","p":{"a":0,"k":[0,0]},"a":{"a":0,"k":[0,0]},
+        "s":{"a":0,"k":[100,100]},"r":{"a":0,"k":0},"o":{"a":0,"k":100}}]},
+     {"ty":"gr","it":[
+       {"ty":"sr","sy":1,"d":1,"pt":{"a":0,"k":5},"p":{"a":0,"k":[64,64]},
+        "r":{"a":1,"k":[{"t":0,"s":[0],"i":{"x":[0.5],"y":[1]},
+                         "o":{"x":[0.5],"y":[0]}},{"t":30,"s":[72]}]},
+        "ir":{"a":0,"k":14},"is":{"a":0,"k":0},
+        "or":{"a":0,"k":34},"os":{"a":0,"k":0}},
+       {"ty":"tm","s":{"a":0,"k":0},"o":{"a":0,"k":0},"m":1,
+        "e":{"a":1,"k":[{"t":0,"s":[20],"i":{"x":[0.5],"y":[1]},
+                         "o":{"x":[0.5],"y":[0]}},{"t":30,"s":[100]}]}},
+       {"ty":"st","c":{"a":0,"k":[1,1,0.6,1]},"o":{"a":0,"k":100},
+        "w":{"a":0,"k":3},"lc":2,"lj":2,"ml":4,
+        "d":[{"n":"d","v":{"a":0,"k":6}},{"n":"g","v":{"a":0,"k":3}},
+             {"n":"o","v":{"a":0,"k":0}}]},
+       {"ty":"tr","p":{"a":0,"k":[0,0]},"a":{"a":0,"k":[0,0]},
+        "s":{"a":0,"k":[100,100]},"r":{"a":0,"k":0},"o":{"a":0,"k":100}}]}]},
+  {"ty":0,"ind":3,"refId":"comp_0","w":128,"h":128,"ip":0,"op":30,"st":0,
+   "ks":{"o":{"a":0,"k":80},"p":{"a":0,"k":[0,0]},"a":{"a":0,"k":[0,0]},
+         "s":{"a":0,"k":[100,100]},"r":{"a":0,"k":0}},
+   "hasMask":true,
+   "masksProperties":[{"mode":"a","inv":false,"o":{"a":0,"k":100},
+     "pt":{"a":1,"k":[
+       {"t":0,"s":[{"c":true,"i":[[0,0],[0,0],[0,0],[0,0]],
+                    "o":[[0,0],[0,0],[0,0],[0,0]],
+                    "v":[[0,0],[48,0],[48,128],[0,128]]}],
+        "i":{"x":0.5,"y":1},"o":{"x":0.5,"y":0}},
+       {"t":30,"s":[{"c":true,"i":[[0,0],[0,0],[0,0],[0,0]],
+                     "o":[[0,0],[0,0],[0,0],[0,0]],
+                     "v":[[0,0],[128,0],[128,128],[0,128]]}]}]}}]},
+  {"ty":1,"ind":4,"sc":"#204060","sw":128,"sh":128,"ip":0,"op":30,"st":0,
+   "ks":{"o":{"a":0,"k":100},"p":{"a":0,"k":[0,0]},"a":{"a":0,"k":[0,0]},
+         "s":{"a":0,"k":[100,100]},"r":{"a":0,"k":0}}}]
+})";
+
+bool endsWith(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void addPath(const std::string &path, std::vector<std::string> &files)
+{
+    DIR *dir = opendir(path.c_str());
+    if (!dir) {
+        files.push_back(path);
+        return;
+    }
+    std::vector<std::string> entries;
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (endsWith(name, ".json")) entries.push_back(path + "/" + name);
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    files.insert(files.end(), entries.begin(), entries.end());
+}
+
+// the number of frames that differ, or -1 when the check couldn't run.
+int check(const std::string &name, const std::string &json,
+          const std::string &resourcePath)
+{
+    auto parsed = rlottie::Animation::loadFromData(json, name, resourcePath,
+                                                   false);
+    if (!parsed) {
+        fprintf(stderr, "%s: can't parse\n", name.c_str());
+        return -1;
+    }
+    std::string model = parsed->serialize();
+    auto        loaded = rlottie::Animation::loadFromData(model, name, "", false);
+    if (!loaded) {
+        fprintf(stderr, "%s: serialized model rejected\n", name.c_str());
+        return -1;
+    }
+
+    int failed = 0;
+    if (loaded->serialize() != model) {
+        fprintf(stderr, "%s: serializes differently once loaded\n",
+                name.c_str());
+        failed++;
+    }
+    if (loaded->totalFrame() != parsed->totalFrame() ||
+        loaded->frameRate() != parsed->frameRate()) {
+        fprintf(stderr, "%s: frame range differs\n", name.c_str());
+        return failed + 1;
+    }
+
+    size_t width, height;
+    parsed->size(width, height);
+    width = std::min<size_t>(std::max<size_t>(width, 1), 512);
+    height = std::min<size_t>(std::max<size_t>(height, 1), 512);
+    std::vector<uint32_t> expected(width * height), actual(width * height);
+    bool                  drawn = false;
+    for (size_t frame = 0; frame < parsed->totalFrame(); frame++) {
+        rlottie::Surface a(expected.data(), width, height, width * 4);
+        rlottie::Surface b(actual.data(), width, height, width * 4);
+        parsed->renderSync(frame, a);
+        loaded->renderSync(frame, b);
+        if (expected != actual) {
+            fprintf(stderr, "%s: frame %zu differs\n", name.c_str(), frame);
+            failed++;
+        }
+        drawn = drawn || std::any_of(expected.begin(), expected.end(),
+                                     [](uint32_t px) { return px != 0; });
+    }
+    if (!drawn) {
+        fprintf(stderr, "%s: nothing drawn\n", name.c_str());
+        failed++;
+    }
+
+    printf("%-40s %8zu json %8zu model %4zu frames %s\n", name.c_str(),
+           json.size(), model.size(), parsed->totalFrame(),
+           failed ? "FAILED" : "ok");
+    return failed;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) addPath(argv[i], files);
+
+    int failed = 0;
+    if (files.empty()) failed = check("built-in", builtIn, "") != 0;
+
+    for (const auto &file : files) {
+        std::ifstream     in(file, std::ios::binary);
+        std::stringstream content;
+        content << in.rdbuf();
+        if (!in.is_open()) {
+            fprintf(stderr, "can't read %s\n", file.c_str());
+            failed++;
+            continue;
+        }
+        auto slash = file.find_last_of("/\\");
+        auto dir = slash == std::string::npos ? "" : file.substr(0, slash + 1);
+        failed += check(file, content.str(), dir) != 0;
+    }
+    return failed ? 1 : 0;
+}
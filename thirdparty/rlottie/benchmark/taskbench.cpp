@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Dispatch overhead microbenchmark of the task scheduler.
+ *
+ * Compares VTaskScheduler against the mutex guarded queues it replaced,
+ * with empty tasks so only queueing, stealing and wake ups are measured:
+ *   inject   a non pool thread queues the tasks and waits for them.
+ *   fanout   a pool task queues children and waits for them, like a
+ *            render task queuing one rasterization per shape.
+ *
+ *   taskbench [threads] [tasks]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "vtaskscheduler.h"
+
+namespace {
+
+using Task = std::function<void()>;
+
+// The scheduler before the lock free deques: one mutex guarded std::deque
+// per worker, polled with try_lock and a condition variable per queue.
+class MutexPool {
+    class Queue {
+        using lock_t = std::unique_lock<std::mutex>;
+        std::deque<Task>        _q;
+        bool                    _done{false};
+        std::mutex              _mutex;
+        std::condition_variable _ready;
+
+    public:
+        bool try_pop(Task &task)
+        {
+            lock_t lock{_mutex, std::try_to_lock};
+            if (!lock || _q.empty()) return false;
+            task = std::move(_q.front());
+            _q.pop_front();
+            return true;
+        }
+
+        bool steal(Task &task)
+        {
+            lock_t lock{_mutex};
+            if (_q.empty()) return false;
+            task = std::move(_q.front());
+            _q.pop_front();
+            return true;
+        }
+
+        bool try_push(Task &&task)
+        {
+            {
+                lock_t lock{_mutex, std::try_to_lock};
+                if (!lock) return false;
+                _q.push_back(std::move(task));
+            }
+            _ready.notify_one();
+            return true;
+        }
+
+        void push(Task &&task)
+        {
+            {
+                lock_t lock{_mutex};
+                _q.push_back(std::move(task));
+            }
+            _ready.notify_one();
+        }
+
+        void done()
+        {
+            {
+                lock_t lock{_mutex};
+                _done = true;
+            }
+            _ready.notify_all();
+        }
+
+        bool pop(Task &task)
+        {
+            lock_t lock{_mutex};
+            while (_q.empty() && !_done) _ready.wait(lock);
+            if (_q.empty()) return false;
+            task = std::move(_q.front());
+            _q.pop_front();
+            return true;
+        }
+    };
+
+    const unsigned           _count;
+    std::vector<Queue>       _q;
+    std::vector<std::thread> _threads;
+    std::atomic<unsigned>    _index{0};
+
+    void run(unsigned i)
+    {
+        Task task;
+        while (true) {
+            bool success = false;
+            for (unsigned n = 0; n != _count * 2; ++n) {
+                if (_q[(i + n) % _count].try_pop(task)) {
+                    success = true;
+                    break;
+                }
+            }
+            if (!success && !_q[i].pop(task)) break;
+            task();
+        }
+    }
+
+public:
+    explicit MutexPool(unsigned count) : _count(count), _q(count)
+    {
+        for (unsigned n = 0; n != _count; ++n)
+            _threads.emplace_back([this, n] { run(n); });
+    }
+
+    ~MutexPool()
+    {
+        for (auto &e : _q) e.done();
+        for (auto &e : _threads) e.join();
+    }
+
+    void process(Task task)
+    {
+        auto i = _index++;
+        for (unsigned n = 0; n != _count; ++n) {
+            if (_q[(i + n) % _count].try_push(std::move(task))) return;
+        }
+        _q[i % _count].push(std::move(task));
+    }
+
+    bool runPending()
+    {
+        auto i = _index++;
+        Task task;
+        for (unsigned n = 0; n != _count; ++n) {
+            if (_q[(i + n) % _count].steal(task)) {
+                task();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+class StealingPool {
+public:
+    explicit StealingPool(unsigned count)
+    {
+        VTaskScheduler::instance().configure(count, false);
+    }
+
+    void process(Task task) { VTaskScheduler::instance().process(std::move(task)); }
+
+    bool runPending() { return VTaskScheduler::instance().runPending(); }
+};
+
+// countdown the waiting thread helps with while it isn't done. The last
+// countDown() signals under the lock, so the waiter can't destroy the latch
+// while it is still in use.
+class Latch {
+public:
+    explicit Latch(size_t count) : mCount(count) {}
+
+    void countDown()
+    {
+        if (--mCount) return;
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFinished = true;
+        mDone.notify_all();
+    }
+
+    template <typename Pool>
+    void wait(Pool &pool)
+    {
+        while (mCount.load()) {
+            if (!pool.runPending()) std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mFinished) mDone.wait(lock);
+    }
+
+private:
+    std::atomic<size_t>     mCount;
+    std::mutex              mMutex;
+    std::condition_variable mDone;
+    bool                    mFinished{false};
+};
+
+template <typename Pool>
+double inject(Pool &pool, size_t tasks)
+{
+    auto  start = std::chrono::steady_clock::now();
+    Latch latch(tasks);
+    for (size_t i = 0; i < tasks; i++) pool.process([&latch] { latch.countDown(); });
+    latch.wait(pool);
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now() - start).count() / double(tasks);
+}
+
+template <typename Pool>
+double fanout(Pool &pool, size_t tasks, size_t children)
+{
+    size_t frames = std::max<size_t>(1, tasks / children);
+    auto   start = std::chrono::steady_clock::now();
+    Latch  frameLatch(frames);
+    for (size_t f = 0; f < frames; f++) {
+        pool.process([&pool, &frameLatch, children] {
+            Latch latch(children);
+            for (size_t i = 0; i < children; i++)
+                pool.process([&latch] { latch.countDown(); });
+            latch.wait(pool);
+            frameLatch.countDown();
+        });
+    }
+    frameLatch.wait(pool);
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now() - start).count() /
+           double(frames * (children + 1));
+}
+
+template <typename Pool>
+void report(const char *name, unsigned threads, size_t tasks)
+{
+    Pool   pool(threads);
+    double best[2] = {1e30, 1e30};
+    for (int pass = 0; pass < 5; pass++) {
+        best[0] = std::min(best[0], inject(pool, tasks));
+        best[1] = std::min(best[1], fanout(pool, tasks, 64));
+    }
+    printf("%-8s %7u %12.1f %12.1f\n", name, threads, best[0], best[1]);
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t   tasks = 200000;
+    if (argc > 1) threads = unsigned(std::max(1l, atol(argv[1])));
+    if (argc > 2) tasks = size_t(std::max(1l, atol(argv[2])));
+
+    printf("%-8s %7s %12s %12s\n", "pool", "threads", "inject ns", "fanout ns");
+    report<MutexPool>("mutex", threads, tasks);
+    report<StealingPool>("stealing", threads, tasks);
+    return 0;
+}
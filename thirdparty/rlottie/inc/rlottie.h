@@ -23,6 +23,8 @@
 #ifndef _RLOTTIE_H_
 #define _RLOTTIE_H_
 
+#include <chrono>
+#include <functional>
 #include <future>
 #include <vector>
 #include <memory>
@@ -42,6 +44,7 @@
 #endif
 
 class AnimationImpl;
+struct RenderTask;
 struct LOTNode;
 struct LOTLayerNode;
 
@@ -64,6 +67,127 @@ namespace rlottie {
  */
 RLOTTIE_API void configureModelCacheSize(size_t cacheSize);
 
+/**
+ *  @brief Limits the memory the model cache holds.
+ *
+ *  The cache drops the least recently used models until both the entry
+ *  count and the bytes the models take are within their limits. A model
+ *  larger than the budget isn't cached. There is no byte limit by default.
+ *
+ *  @param[in] budget  Maximum bytes taken by the cached models,
+ *                     0 disables the cache like configureModelCacheSize().
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureModelCacheBudget(size_t budget);
+
+/**
+ *  @brief What the model cache finds models by, @see configureModelCacheKey().
+ */
+enum class ModelCacheKey {
+    Caller,   /* the key given to loadFromData(), the path for loadFromFile() */
+    Content   /* a hash of the data and the resource path */
+};
+
+/**
+ *  @brief Configures what the model cache finds models by.
+ *
+ *  Keying on content shares one model between identical resources and
+ *  never returns a stale model for a file that changed on disk, at the
+ *  cost of hashing the data on every load. loadFromData() calls with an
+ *  empty key are keyed on content either way.
+ *
+ *  @param[in] key  Caller keys by default.
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureModelCacheKey(ModelCacheKey key);
+
+/**
+ *  @brief Counters of the model cache, @see modelCacheStats().
+ */
+struct ModelCacheStats {
+    size_t hits{0};
+    size_t misses{0};
+    size_t evictions{0};   /* models dropped to stay within the limits */
+    size_t entries{0};     /* models cached now */
+    size_t bytes{0};       /* memory taken by the cached models */
+    size_t capacity{0};    /* entry limit, @see configureModelCacheSize() */
+    size_t budget{0};      /* byte limit, @see configureModelCacheBudget() */
+};
+
+/**
+ *  @brief Returns the counters of the model cache.
+ *
+ *  Hits, misses and evictions add up since the library was loaded.
+ *
+ *  @internal
+ */
+RLOTTIE_API ModelCacheStats modelCacheStats();
+
+/**
+ *  @brief Thread pool provided by the application.
+ *
+ *  Lets rlottie run its render and rasterization work on the threads of the
+ *  host instead of creating its own.
+ *
+ *  @see setExecutor()
+ *
+ *  @internal
+ */
+class RLOTTIE_API Executor {
+public:
+    virtual ~Executor() = default;
+
+    /**
+     *  @brief Runs the job on one of the host threads.
+     *
+     *  Every job must be called exactly once. A job can wait for other
+     *  rlottie jobs but runs them on its own thread meanwhile, so the host
+     *  needs no minimum number of threads.
+     *
+     *  @param[in] job  work to run.
+     */
+    virtual void execute(std::function<void()> job) = 0;
+};
+
+/**
+ *  @brief Configures the thread pool shared by all the animations.
+ *
+ *  Asynchronous renders and path rasterization run on one pool of worker
+ *  threads, created when the first task is queued.
+ *
+ *  @param[in] threadCount  Number of worker threads, 0 uses one thread per core.
+ *  @param[in] pinThreads   Pin every worker to its own core, where supported.
+ *
+ *  @note Tasks queued before the call finish on the previous workers.
+ *        Must not be called from a render callback.
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureThreadPool(unsigned threadCount,
+                                     bool     pinThreads = false);
+
+/**
+ *  @brief Returns the number of worker threads of the pool.
+ *
+ *  @return worker count, 0 when an Executor runs the work.
+ *
+ *  @internal
+ */
+RLOTTIE_API unsigned threadPoolSize();
+
+/**
+ *  @brief Runs the work of the thread pool on an application executor.
+ *
+ *  The pool stops its own workers while an executor is set.
+ *
+ *  @param[in] executor  host executor, nullptr restores the internal workers.
+ *
+ *  @internal
+ */
+RLOTTIE_API void setExecutor(std::shared_ptr<Executor> executor);
+
 struct Color {
     Color() = default;
     Color(float r, float g , float b):_r(r), _g(g), _b(b){}
@@ -124,6 +248,21 @@ template <typename T> struct MapType;
 
 class RLOTTIE_API Surface {
 public:
+    /**
+     *  @brief Pixel layouts a surface can be rendered in.
+     *
+     *  The names describe a 32 bit pixel value, so on little endian
+     *  machines ARGB32 is stored as B, G, R, A bytes and ABGR32 as
+     *  R, G, B, A bytes. The formats without the _Premultiplied suffix
+     *  hold straight (non premultiplied) alpha.
+     */
+    enum class Format {
+        ARGB32_Premultiplied,
+        ABGR32_Premultiplied,
+        ARGB32,
+        ABGR32
+    };
+
     /**
      *  @brief Surface object constructor.
      *
@@ -238,6 +377,116 @@ public:
      */
     size_t drawRegionPosY() const {return mDrawArea.y;}
 
+    /**
+     *  @brief Sets the pixel layout the frame is written in.
+     *
+     *  Any layout other than ARGB32_Premultiplied is produced by
+     *  converting the draw region in place once the frame is rendered.
+     *
+     *  @param[in] format pixel layout of the surface buffer.
+     *
+     *  @note Default surface format is ARGB32_Premultiplied.
+     *
+     *  @internal
+     */
+    void setFormat(Format format) {mFormat = format;}
+
+    /**
+     *  @brief Returns pixel layout of the surface.
+     *
+     *  @return surface format.
+     *
+     *  @internal
+     */
+    Format format() const {return mFormat;}
+
+    /**
+     *  @brief Limits clearing the surface before a frame is drawn to the
+     *         given region.
+     *
+     *  Use it when rendering into the same buffer again, passing the dirty
+     *  region of the previous frame, so only the pixels that frame touched
+     *  are cleared. Everything outside the region must already be
+     *  transparent.
+     *
+     *  @param[in] x      region area x position.
+     *  @param[in] y      region area y position.
+     *  @param[in] width  region area width.
+     *  @param[in] height region area height.
+     *
+     *  @note Default clear region is the whole surface.
+     *
+     *  @internal
+     */
+    void setClearRegion(size_t x, size_t y, size_t width, size_t height);
+
+    /**
+     *  @brief Sets the region of the surface touched by the last render.
+     *
+     *  Called by the renderer, pixels outside the region are transparent.
+     *
+     *  @internal
+     */
+    void setDirtyRegion(size_t x, size_t y, size_t width, size_t height);
+
+    /**
+     *  @brief Returns dirty region's x position of the surface.
+     *
+     *  @note Default dirty region is the whole surface.
+     *
+     *  @internal
+     */
+    size_t dirtyRegionPosX() const {return mDirtyArea.x;}
+
+    /**
+     *  @brief Returns dirty region's y position of the surface.
+     *
+     *  @internal
+     */
+    size_t dirtyRegionPosY() const {return mDirtyArea.y;}
+
+    /**
+     *  @brief Returns dirty region width of the surface.
+     *
+     *  @internal
+     */
+    size_t dirtyRegionWidth() const {return mDirtyArea.w;}
+
+    /**
+     *  @brief Returns dirty region height of the surface.
+     *
+     *  @internal
+     */
+    size_t dirtyRegionHeight() const {return mDirtyArea.h;}
+
+    /**
+     *  @brief Returns clear region's x position of the surface.
+     *
+     *  @internal
+     */
+    size_t clearRegionPosX() const {return mClearArea.x;}
+
+    /**
+     *  @brief Returns clear region's y position of the surface.
+     *
+     *  @internal
+     */
+    size_t clearRegionPosY() const {return mClearArea.y;}
+
+    /**
+     *  @brief Returns clear region width of the surface.
+     *
+     *  @internal
+     */
+    size_t clearRegionWidth() const {return mClearArea.w;}
+
+    /**
+     *  @brief Returns clear region height of the surface.
+     *
+     *  @internal
+     */
+    size_t clearRegionHeight() const {return mClearArea.h;}
+
     /**
      *  @brief Default constructor.
      */
@@ -247,12 +496,16 @@ private:
     size_t       mWidth{0};
     size_t       mHeight{0};
     size_t       mBytesPerLine{0};
-    struct {
+    Format       mFormat{Format::ARGB32_Premultiplied};
+    struct Area {
         size_t   x{0};
         size_t   y{0};
         size_t   w{0};
         size_t   h{0};
-    }mDrawArea;
+    };
+    Area         mDrawArea;
+    Area         mClearArea;
+    Area         mDirtyArea;
 };
 
 using MarkerList = std::vector<std::tuple<std::string, int , int>>;
@@ -268,13 +521,86 @@ using LayerInfoList = std::vector<std::tuple<std::string, int , int>>;
 
 using ColorFilter = std::function<void(float &r , float &g, float &b)>;
 
+/**
+ *  @brief Counters gathered while an Animation renders with profiling
+ *         enabled, @see Animation::setProfiling(). Times are in milliseconds.
+ */
+struct RenderStats {
+    struct Layer {
+        std::string name;
+        double      updateTime{0}; /* child layers included */
+        double      renderTime{0}; /* child layers included */
+        size_t      spanCount{0};
+        size_t      maskCount{0};
+        size_t      matteCount{0};
+    };
+    double parseTime{0};      /* near 0 when the model came from the cache */
+    double updateTime{0};     /* evaluating the model for a frame */
+    double rasterTime{0};     /* scheduling (and inline) path rasterization */
+    double paintTime{0};      /* blending, waiting on pending rasterization */
+    double convertTime{0};    /* surface format conversion */
+    size_t frameCount{0};
+    size_t spanCount{0};      /* rle spans blended */
+    size_t maskCount{0};      /* layer masks applied */
+    size_t matteCount{0};     /* track mattes composited */
+    std::vector<Layer> layers; /* top level layers of the composition */
+};
+
+/**
+ *  @brief How soon the frame of a queued render is needed,
+ *         @see Animation::render().
+ */
+enum class RenderPriority {
+    Visible,   /* about to be shown, runs before any prefetch */
+    Prefetch   /* ahead of playback, runs when no visible frame waits */
+};
+
+/**
+ *  @brief Handle to a render queued with Animation::render().
+ *
+ *  Holds the future of the render and lets the caller drop the request
+ *  while it still waits in the queue, e.g. when playback skipped ahead.
+ */
+class RLOTTIE_API RenderTicket {
+public:
+    /**
+     *  @brief Drops the render if it didn't start yet. The future then
+     *         holds the surface untouched, with an empty dirty region.
+     *
+     *  @return true if the render was dropped.
+     */
+    bool cancel();
+
+    /**
+     *  @brief Whether the render was dropped, by cancel() or because it
+     *         couldn't start before its deadline.
+     */
+    bool cancelled() const;
+
+    /**
+     *  @brief Future holding the surface once the render finished or was
+     *         dropped.
+     */
+    std::future<Surface> &future() {return mFuture;}
+
+    /**
+     *  @brief Default constructor.
+     */
+    RenderTicket() = default;
+private:
+    friend class ::AnimationImpl;
+    std::shared_ptr<RenderTask> mTask;
+    std::future<Surface>        mFuture;
+};
+
 class RLOTTIE_API Animation {
 public:
 
     /**
      *  @brief Constructs an animation object from file path.
      *
-     *  @param[in] path Lottie resource file path
+     *  @param[in] path Lottie resource file path, JSON or a model written
+     *             by serialize().
      *  @param[in] cachePolicy whether to cache or not the model data.
      *             use only when need to explicit disabl caching for a
      *             particular resource. To disable caching at library level
@@ -291,8 +617,9 @@ public:
     /**
      *  @brief Constructs an animation object from JSON string data.
      *
-     *  @param[in] jsonData The JSON string data.
-     *  @param[in] key the string that will be used to cache the JSON string data.
+     *  @param[in] jsonData The JSON string data, or a model from serialize().
+     *  @param[in] key the string that will be used to cache the JSON string data,
+     *             empty to cache by content, @see configureModelCacheKey().
      *  @param[in] resourcePath the path will be used to search for external resource.
      *  @param[in] cachePolicy whether to cache or not the model data.
      *             use only when need to explicit disabl caching for a
@@ -308,6 +635,30 @@ public:
     loadFromData(std::string jsonData, const std::string &key,
                  const std::string &resourcePath="", bool cachePolicy=true);
 
+    /**
+     *  @brief Constructs an animation object from a buffer the caller hands
+     *  over, without copying it.
+     *
+     *  The JSON is parsed in place, so the buffer content is altered. It
+     *  doesn't need to be '\0' terminated and isn't referenced once this
+     *  returns.
+     *
+     *  @param[in] data The JSON data, or a model from serialize().
+     *  @param[in] size size of the data in bytes.
+     *  @param[in] key the string that will be used to cache the JSON string data,
+     *             empty to cache by content, @see configureModelCacheKey().
+     *  @param[in] resourcePath the path will be used to search for external resource.
+     *  @param[in] cachePolicy whether to cache or not the model data.
+     *
+     *  @return Animation object that can render the contents of the
+     *          Lottie resource represented by the data.
+     *
+     *  @internal
+     */
+    static std::unique_ptr<Animation>
+    loadFromData(char *data, size_t size, const std::string &key,
+                 const std::string &resourcePath="", bool cachePolicy=true);
+
     /**
      *  @brief Constructs an animation object from JSON string data and update.
      *  the color properties using ColorFilter.
@@ -402,6 +753,7 @@ public:
      *
      *  @return future that will hold the result when rendering finished.
      *
+     *  Queued as a visible render without deadline.
      *  for Synchronus rendering @see renderSync
      *
      *  @see Surface
@@ -409,6 +761,30 @@ public:
      */
     std::future<Surface> render(size_t frameNo, Surface surface, bool keepAspectRatio=true);
 
+    /**
+     *  @brief Queues a render of the content to surface.
+     *
+     *  Queued renders of all animations share the thread pool, visible ones
+     *  go first, then the ones with the earliest deadline, then the oldest.
+     *  Renders of one animation run one after the other. A render that
+     *  couldn't start before @p deadline is dropped, its frame would be late.
+     *
+     *  @param[in] frameNo Content corresponds to the @p frameNo needs to be drawn
+     *  @param[in] surface Surface in which content will be drawn
+     *  @param[in] priority how soon the frame is needed.
+     *  @param[in] deadline time the render has to start by, none by default.
+     *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *
+     *  @return ticket to wait for or cancel the render.
+     *
+     *  @see RenderTicket
+     *  @internal
+     */
+    RenderTicket render(size_t frameNo, Surface surface, RenderPriority priority,
+                        std::chrono::steady_clock::time_point deadline =
+                            std::chrono::steady_clock::time_point::max(),
+                        bool keepAspectRatio = true);
+
     /**
      *  @brief Renders the content to surface synchronously.
      *         for performance use the async rendering @see render
@@ -421,6 +797,40 @@ public:
      */
     void              renderSync(size_t frameNo, Surface surface, bool keepAspectRatio=true);
 
+    /**
+     *  @brief Called with every frame renderFrames() finished, on the thread
+     *         that rendered it, before its future becomes ready.
+     */
+    using FrameCallback = std::function<void(size_t frameNo, const Surface &surface)>;
+
+    /**
+     *  @brief Renders a range of frames in parallel, for baking sprite sheets
+     *         and other offline work.
+     *
+     *  Frame @p firstFrame + i is drawn into surfaces[i]. The frames are spread
+     *  over the thread pool, each thread rendering with its own copy of the
+     *  render tree over the shared model, so this can run next to render()
+     *  or another renderFrames() call on the same Animation. Values set with
+     *  setValue() before the call apply to the frames, as do tiled rendering
+     *  and profiling, whose stats add to renderStats().
+     *
+     *  @param[in] firstFrame Frame drawn into the first surface.
+     *  @param[in] surfaces One surface per frame, their buffers must stay
+     *             valid until the frame is done.
+     *  @param[in] callback Optional, invoked as each frame completes.
+     *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *
+     *  @return one future per surface, holding it once its frame is rendered.
+     *
+     *  @note A render tree copy is made per thread taking part.
+     *        Don't wait for the futures from a render callback.
+     *
+     *  @internal
+     */
+    std::vector<std::future<Surface>> renderFrames(size_t firstFrame, std::vector<Surface> surfaces,
+                                                   FrameCallback callback = nullptr,
+                                                   bool keepAspectRatio = true);
+
     /**
      *  @brief Returns root layer of the composition updated with
      *         content of the Lottie resource at frame number @p frameNo.
@@ -457,6 +867,79 @@ public:
      */
     const LayerInfoList& layers() const;
 
+    /**
+     *  @brief Returns the parsed model in rlottie's binary model format.
+     *
+     *  loadFromData() and loadFromFile() take the result in place of the
+     *  JSON and restore the model without parsing it. Image assets are
+     *  stored decoded. Values set with setValue() are not part of the model.
+     *
+     *  @note The format is only read back by the same rlottie version on a
+     *        machine of the same byte order, other data is rejected.
+     *
+     *  @internal
+     */
+    std::string serialize() const;
+
+    /**
+     *  @brief Enables gathering RenderStats on every frame rendered.
+     *
+     *  @param[in] enable whether to profile rendering.
+     *
+     *  @note Profiling is disabled by default.
+     *
+     *  @internal
+     */
+    void setProfiling(bool enable);
+
+    /**
+     *  @brief Returns the RenderStats gathered since the Animation was
+     *         loaded or the stats were reset.
+     *
+     *  @note Must not be called while a frame is rendering.
+     *
+     *  @see RenderStats
+     *  @internal
+     */
+    RenderStats renderStats() const;
+
+    /**
+     *  @brief Clears the gathered RenderStats, parse time excepted.
+     *
+     *  @internal
+     */
+    void resetRenderStats();
+
+    /**
+     *  @brief Enables pipelined playback.
+     *
+     *  While a frame is drawn, the model is evaluated for the predicted next
+     *  frame (same step as the last call, looping at the end) on a second
+     *  renderer in the thread pool. A render() call for that frame then only
+     *  has to draw it. Other frames render as usual.
+     *
+     *  @param[in] enable  pipelining state, off by default.
+     *
+     *  @note Keeps a second render tree, about doubling its memory.
+     *
+     *  @internal
+     */
+    void setPipelining(bool enable);
+
+    /**
+     *  @brief Enables painting large frames in tiles.
+     *
+     *  The rasterized frame is blended in horizontal bands, one per thread of
+     *  the pool, each clipped to its rows with its own layer buffers for masks
+     *  and mattes. Frames under 512x512 pixels, and frames rendered while
+     *  profiling, are painted in one piece.
+     *
+     *  @param[in] enable  tiling state, off by default.
+     *
+     *  @internal
+     */
+    void setTiledRendering(bool enable);
+
     /**
      *  @brief Sets property value for the specified {@link KeyPath}. This {@link KeyPath} can resolve
      *  to multiple contents. In that case, the callback's value will apply to all of them.
@@ -23,8 +23,13 @@
 #include "lottieitem.h"
 #include "lottiemodel.h"
 #include "rlottie.h"
+#include "velapsedtimer.h"
+#include "vtaskscheduler.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 
 using namespace rlottie;
 using namespace rlottie::internal;
@@ -34,20 +39,176 @@ RLOTTIE_API void rlottie::configureModelCacheSize(size_t cacheSize)
     internal::model::configureModelCacheSize(cacheSize);
 }
 
+RLOTTIE_API void rlottie::configureModelCacheBudget(size_t budget)
+{
+    internal::model::configureModelCacheBudget(budget);
+}
+
+RLOTTIE_API void rlottie::configureModelCacheKey(ModelCacheKey key)
+{
+    internal::model::configureModelCacheKey(key);
+}
+
+RLOTTIE_API ModelCacheStats rlottie::modelCacheStats()
+{
+    return internal::model::modelCacheStats();
+}
+
+RLOTTIE_API void rlottie::configureThreadPool(unsigned threadCount,
+                                              bool     pinThreads)
+{
+    VTaskScheduler::instance().configure(threadCount, pinThreads);
+}
+
+RLOTTIE_API unsigned rlottie::threadPoolSize()
+{
+    return VTaskScheduler::instance().threadCount();
+}
+
+RLOTTIE_API void rlottie::setExecutor(std::shared_ptr<Executor> executor)
+{
+    if (!executor) {
+        VTaskScheduler::instance().setExecutor(nullptr);
+        return;
+    }
+    VTaskScheduler::instance().setExecutor(
+        [executor](std::function<void()> job) {
+            executor->execute(std::move(job));
+        });
+}
+
 struct RenderTask {
-    RenderTask() { receiver = sender.get_future(); }
-    std::promise<Surface> sender;
-    std::future<Surface>  receiver;
-    AnimationImpl *       playerImpl{nullptr};
-    size_t                frameNo{0};
-    Surface               surface;
-    bool                  keepAspectRatio{true};
+    enum State { Queued, Running, Finished, Dropped };
+
+    AnimationImpl *                       playerImpl{nullptr};
+    size_t                                frameNo{0};
+    Surface                               surface;
+    bool                                  keepAspectRatio{true};
+    RenderPriority                        priority{RenderPriority::Visible};
+    std::chrono::steady_clock::time_point deadline;
+    size_t                                sequence{0};
+    std::promise<Surface>                 sender;
+    std::atomic<int>                      state{Queued};
+
+    // only the thread that moved the task out of Queued completes it.
+    void drop()
+    {
+        surface.setDirtyRegion(0, 0, 0, 0);
+        sender.set_value(surface);
+    }
 };
 using SharedRenderTask = std::shared_ptr<RenderTask>;
 
+/*
+ * Queued renders of all animations. Every render posts one job to the
+ * thread pool and a job runs the most urgent render queued by then, so the
+ * order of the pool doesn't matter. Renders of one animation run one at a
+ * time, a job that only finds busy animations leaves and the render
+ * finishing there posts another one.
+ */
+class RenderQueue {
+public:
+    static RenderQueue &instance()
+    {
+        static RenderQueue singleton;
+        return singleton;
+    }
+
+    void push(SharedRenderTask task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            task->sequence = mSequence++;
+            mTasks.push_back(std::move(task));
+        }
+        VTaskScheduler::instance().process([this] { runNext(); });
+    }
+
+    // drops the queued renders of player and waits for the running one.
+    void remove(AnimationImpl *player)
+    {
+        std::vector<SharedRenderTask> dropped;
+        std::unique_lock<std::mutex>  lock(mMutex);
+        for (auto &task : mTasks) {
+            int queued = RenderTask::Queued;
+            if (task->playerImpl == player &&
+                task->state.compare_exchange_strong(queued,
+                                                    RenderTask::Dropped))
+                dropped.push_back(task);
+        }
+        while (std::find(mBusy.begin(), mBusy.end(), player) != mBusy.end())
+            mIdle.wait(lock);
+        lock.unlock();
+
+        for (auto &task : dropped) task->drop();
+    }
+
+private:
+    // the pool outlives the queue its jobs point to.
+    RenderQueue() { VTaskScheduler::instance(); }
+
+    static bool before(const RenderTask &a, const RenderTask &b)
+    {
+        if (a.priority != b.priority) return a.priority < b.priority;
+        if (a.deadline != b.deadline) return a.deadline < b.deadline;
+        return a.sequence < b.sequence;
+    }
+
+    void runNext();
+
+    // claims the most urgent render of an idle animation, renders past
+    // their deadline are handed back to be dropped.
+    SharedRenderTask take(std::vector<SharedRenderTask> &expired)
+    {
+        auto now = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto last = std::remove_if(
+            mTasks.begin(), mTasks.end(), [&](SharedRenderTask &task) {
+                int queued = RenderTask::Queued;
+                if (task->deadline < now &&
+                    task->state.compare_exchange_strong(queued,
+                                                        RenderTask::Dropped))
+                    expired.push_back(task);
+                return task->state != RenderTask::Queued;
+            });
+        mTasks.erase(last, mTasks.end());
+
+        auto best = mTasks.end();
+        for (auto it = mTasks.begin(); it != mTasks.end(); ++it) {
+            bool busy = std::find(mBusy.begin(), mBusy.end(),
+                                  (*it)->playerImpl) != mBusy.end();
+            if (!busy && (best == mTasks.end() || before(**it, **best)))
+                best = it;
+        }
+        if (best == mTasks.end()) return nullptr;
+
+        // a cancel() racing with us wins, the next job looks again.
+        SharedRenderTask task = *best;
+        mTasks.erase(best);
+        int queued = RenderTask::Queued;
+        if (!task->state.compare_exchange_strong(queued, RenderTask::Running))
+            return nullptr;
+        mBusy.push_back(task->playerImpl);
+        return task;
+    }
+
+    std::mutex                    mMutex;
+    std::condition_variable       mIdle;
+    std::vector<SharedRenderTask> mTasks;
+    std::vector<AnimationImpl *>  mBusy;
+    size_t                        mSequence{0};
+};
+
 class AnimationImpl {
 public:
-    void    init(std::shared_ptr<model::Composition> composition);
+    ~AnimationImpl()
+    {
+        RenderQueue::instance().remove(this);
+        finishPrefetch();
+    }
+    void    init(std::shared_ptr<model::Composition> composition,
+                 double                              parseTime);
     bool    update(size_t frameNo, const VSize &size, bool keepAspectRatio);
     VSize   size() const { return mModel->size(); }
     double  duration() const { return mModel->duration(); }
@@ -56,8 +217,13 @@ public:
     size_t  frameAtPos(double pos) const { return mModel->frameAtPos(pos); }
     Surface render(size_t frameNo, const Surface &surface,
                    bool keepAspectRatio);
-    std::future<Surface> renderAsync(size_t frameNo, Surface &&surface,
-                                     bool keepAspectRatio);
+    RenderTicket render(size_t frameNo, Surface &&surface,
+                        RenderPriority                        priority,
+                        std::chrono::steady_clock::time_point deadline,
+                        bool                                  keepAspectRatio);
+    std::vector<std::future<Surface>> renderFrames(
+        size_t firstFrame, std::vector<Surface> &&surfaces,
+        Animation::FrameCallback &&callback, bool keepAspectRatio);
     const LOTLayerNode * renderTree(size_t frameNo, const VSize &size);
 
     const LayerInfoList &layerInfoList() const
@@ -68,33 +234,203 @@ public:
         return mLayerList;
     }
     const MarkerList &markers() const { return mModel->markers(); }
+    std::string       serialize() const { return model::serialize(*mModel); }
     void              setValue(const std::string &keypath, LOTVariant &&value);
     void              removeFilter(const std::string &keypath, Property prop);
+    void              setProfiling(bool enable);
+    RenderStats       renderStats() const;
+    void              resetRenderStats();
+    void              setPipelining(bool enable);
+    void              setTiledRendering(bool enable);
 
 private:
+    struct Prefetch;
+    struct FrameBatch;
+    struct BatchStats;
+
+    int  modelFrame(size_t frameNo) const;
+    void startPrefetch(size_t frameNo, const VSize &size,
+                       bool keepAspectRatio);
+    bool finishPrefetch(size_t frameNo, const VSize &size,
+                        bool keepAspectRatio);
+    void finishPrefetch() const;
+
     mutable LayerInfoList                  mLayerList;
+    std::shared_ptr<model::Composition>    mComposition;
     model::Composition *                   mModel;
-    SharedRenderTask                       mTask;
     std::atomic<bool>                      mRenderInProgress;
     std::unique_ptr<renderer::Composition> mRenderer{nullptr};
+    std::unique_ptr<renderer::Composition> mNextRenderer{nullptr};
+    mutable std::shared_ptr<Prefetch>      mPrefetch;
+    std::shared_ptr<BatchStats>            mBatchStats;
+    std::vector<std::pair<std::string, LOTVariant>> mValues;
+    size_t                                 mLastFrameNo{0};
+    bool                                   mProfiling{false};
+    bool                                   mTiling{false};
+    double                                 mParseTime{0};
 };
 
-void AnimationImpl::setValue(const std::string &keypath, LOTVariant &&value)
+/*
+ * Evaluation of the predicted next frame on the second renderer, queued on
+ * the thread pool while the current frame is drawn. Whoever claims it
+ * first runs it, so a prefetch nobody started yet runs inline.
+ */
+struct AnimationImpl::Prefetch {
+    renderer::Composition *renderer;
+    int                    frameNo;
+    VSize                  size;
+    bool                   keepAspectRatio;
+
+    std::atomic<bool>       claimed{false};
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    done{false};
+
+    void run()
+    {
+        if (claimed.exchange(true)) return;
+
+        renderer->update(frameNo, size, keepAspectRatio);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        cv.notify_all();
+    }
+
+    void finish()
+    {
+        run();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!done) {
+            lock.unlock();
+            bool helped = VTaskScheduler::instance().runPending();
+            lock.lock();
+            if (!helped && !done) cv.wait(lock);
+        }
+    }
+};
+
+// what the renderFrames() clones measured, they report it as they go.
+struct AnimationImpl::BatchStats {
+    std::mutex  mutex;
+    RenderStats stats;
+};
+
+static void addStats(RenderStats &stats, const RenderStats &other)
 {
-    if (keypath.empty()) return;
-    mRenderer->setValue(keypath, value);
+    stats.updateTime += other.updateTime;
+    stats.rasterTime += other.rasterTime;
+    stats.paintTime += other.paintTime;
+    stats.convertTime += other.convertTime;
+    stats.frameCount += other.frameCount;
+    stats.spanCount += other.spanCount;
+    stats.maskCount += other.maskCount;
+    stats.matteCount += other.matteCount;
+    if (stats.layers.empty()) {
+        stats.layers = other.layers;
+        return;
+    }
+    for (size_t i = 0; i < stats.layers.size() && i < other.layers.size(); i++) {
+        stats.layers[i].updateTime += other.layers[i].updateTime;
+        stats.layers[i].renderTime += other.layers[i].renderTime;
+        stats.layers[i].spanCount += other.layers[i].spanCount;
+        stats.layers[i].maskCount += other.layers[i].maskCount;
+        stats.layers[i].matteCount += other.layers[i].matteCount;
+    }
 }
 
-const LOTLayerNode *AnimationImpl::renderTree(size_t frameNo, const VSize &size)
+/*
+ * Frames of a renderFrames() call. The renderers are clones over the shared
+ * model, a task takes an idle one or creates it, so there are about as many
+ * as tasks run at once. The batch owns everything it needs and outlives the
+ * Animation if it has to.
+ */
+struct AnimationImpl::FrameBatch {
+    std::shared_ptr<model::Composition>             composition;
+    std::vector<std::pair<std::string, LOTVariant>> values;
+    std::vector<int>                                frames;
+    std::vector<Surface>                            surfaces;
+    std::vector<std::promise<Surface>>              results;
+    Animation::FrameCallback                        callback;
+    size_t                                          firstFrame;
+    bool                                            keepAspectRatio;
+    bool                                            tiling;
+    std::shared_ptr<BatchStats>                     stats;
+
+    std::mutex                                          mutex;
+    std::vector<std::unique_ptr<renderer::Composition>> idle;
+
+    std::unique_ptr<renderer::Composition> acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle.empty()) {
+                auto renderer = std::move(idle.back());
+                idle.pop_back();
+                return renderer;
+            }
+        }
+        auto renderer = std::make_unique<renderer::Composition>(composition);
+        renderer->setTiling(tiling);
+        renderer->setProfiling(bool(stats));
+        for (auto &value : values) renderer->setValue(value.first, value.second);
+        return renderer;
+    }
+
+    void release(std::unique_ptr<renderer::Composition> renderer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(std::move(renderer));
+    }
+
+    void render(size_t index)
+    {
+        auto     renderer = acquire();
+        Surface &surface = surfaces[index];
+        VSize    size(int(surface.drawRegionWidth()),
+                   int(surface.drawRegionHeight()));
+        renderer->update(frames[index], size, keepAspectRatio);
+        renderer->render(surface);
+        if (stats) {
+            RenderStats frame;
+            renderer->stats(frame);
+            renderer->resetStats();
+            std::lock_guard<std::mutex> lock(stats->mutex);
+            addStats(stats->stats, frame);
+        }
+        release(std::move(renderer));
+
+        if (callback) callback(firstFrame + index, surface);
+        results[index].set_value(surface);
+    }
+};
+
+void RenderQueue::runNext()
 {
-    if (update(frameNo, size, true)) {
-        mRenderer->buildRenderTree();
+    std::vector<SharedRenderTask> expired;
+    SharedRenderTask              task = take(expired);
+    for (auto &e : expired) e->drop();
+    if (!task) return;
+
+    auto result = task->playerImpl->render(task->frameNo, task->surface,
+                                           task->keepAspectRatio);
+    task->state = RenderTask::Finished;
+
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBusy.erase(std::find(mBusy.begin(), mBusy.end(), task->playerImpl));
+        more = !mTasks.empty();
     }
-    return mRenderer->renderTree();
+    mIdle.notify_all();
+    task->sender.set_value(result);
+
+    if (more) VTaskScheduler::instance().process([this] { runNext(); });
 }
 
-bool AnimationImpl::update(size_t frameNo, const VSize &size,
-                           bool keepAspectRatio)
+int AnimationImpl::modelFrame(size_t frameNo) const
 {
     frameNo += mModel->startFrame();
 
@@ -102,150 +438,230 @@ bool AnimationImpl::update(size_t frameNo, const VSize &size,
 
     if (frameNo < mModel->startFrame()) frameNo = mModel->startFrame();
 
-    return mRenderer->update(int(frameNo), size, keepAspectRatio);
+    return int(frameNo);
 }
 
-Surface AnimationImpl::render(size_t frameNo, const Surface &surface,
-                              bool keepAspectRatio)
+void AnimationImpl::finishPrefetch() const
 {
-    bool renderInProgress = mRenderInProgress.load();
-    if (renderInProgress) {
-        vCritical << "Already Rendering Scheduled for this Animation";
-        return surface;
-    }
+    if (!mPrefetch) return;
+    mPrefetch->finish();
+    mPrefetch.reset();
+}
 
-    mRenderInProgress.store(true);
-    update(
-        frameNo,
-        VSize(int(surface.drawRegionWidth()), int(surface.drawRegionHeight())),
-        keepAspectRatio);
-    mRenderer->render(surface);
-    mRenderInProgress.store(false);
+// true when the second renderer holds the requested frame.
+bool AnimationImpl::finishPrefetch(size_t frameNo, const VSize &size,
+                                   bool keepAspectRatio)
+{
+    if (!mPrefetch) return false;
 
-    return surface;
+    auto prefetch = std::move(mPrefetch);
+    prefetch->finish();
+    return prefetch->frameNo == modelFrame(frameNo) &&
+           prefetch->size == size &&
+           prefetch->keepAspectRatio == keepAspectRatio;
 }
 
-void AnimationImpl::init(std::shared_ptr<model::Composition> composition)
+// playback usually keeps its step and loops at the end.
+void AnimationImpl::startPrefetch(size_t frameNo, const VSize &size,
+                                  bool keepAspectRatio)
 {
-    mModel = composition.get();
-    mRenderer = std::make_unique<renderer::Composition>(composition);
-    mRenderInProgress = false;
+    size_t step = frameNo > mLastFrameNo ? frameNo - mLastFrameNo : 1;
+    size_t next = frameNo + step;
+    if (next >= totalFrame()) next = 0;
+    mLastFrameNo = frameNo;
+
+    auto prefetch = std::make_shared<Prefetch>();
+    prefetch->renderer = mNextRenderer.get();
+    prefetch->frameNo = modelFrame(next);
+    prefetch->size = size;
+    prefetch->keepAspectRatio = keepAspectRatio;
+    mPrefetch = prefetch;
+
+    VTaskScheduler::instance().process([prefetch] { prefetch->run(); });
 }
 
-#ifdef LOTTIE_THREAD_SUPPORT
+void AnimationImpl::setPipelining(bool enable)
+{
+    finishPrefetch();
+    if (!enable) {
+        mNextRenderer.reset();
+        return;
+    }
+    if (mNextRenderer) return;
 
-#include <thread>
-#include "vtaskqueue.h"
+    mNextRenderer = std::make_unique<renderer::Composition>(mComposition);
+    mNextRenderer->setProfiling(mProfiling);
+    mNextRenderer->setTiling(mTiling);
+    for (auto &value : mValues)
+        mNextRenderer->setValue(value.first, value.second);
+}
 
-/*
- * Implement a task stealing schduler to perform render task
- * As each player draws into its own buffer we can delegate this
- * task to a slave thread. The scheduler creates a threadpool depending
- * on the number of cores available in the system and does a simple fair
- * scheduling by assigning the task in a round-robin fashion. Each thread
- * in the threadpool has its own queue. once it finishes all the task on its
- * own queue it goes through rest of the queue and looks for task if it founds
- * one it steals the task from it and executes. if it couldn't find one then it
- * just waits for new task on its own queue.
- */
-class RenderTaskScheduler {
-    const unsigned           _count{std::thread::hardware_concurrency()};
-    std::vector<std::thread> _threads;
-    std::vector<TaskQueue<SharedRenderTask>> _q{_count};
-    std::atomic<unsigned>                    _index{0};
+void AnimationImpl::setTiledRendering(bool enable)
+{
+    finishPrefetch();
+    mTiling = enable;
+    mRenderer->setTiling(enable);
+    if (mNextRenderer) mNextRenderer->setTiling(enable);
+}
 
-    void run(unsigned i)
-    {
-        while (true) {
-            bool             success = false;
-            SharedRenderTask task;
-            for (unsigned n = 0; n != _count * 2; ++n) {
-                if (_q[(i + n) % _count].try_pop(task)) {
-                    success = true;
-                    break;
-                }
-            }
-            if (!success && !_q[i].pop(task)) break;
+void AnimationImpl::setProfiling(bool enable)
+{
+    finishPrefetch();
+    mProfiling = enable;
+    mRenderer->setProfiling(enable);
+    if (mNextRenderer) mNextRenderer->setProfiling(enable);
+    if (enable && !mBatchStats) mBatchStats = std::make_shared<BatchStats>();
+}
 
-            auto result = task->playerImpl->render(task->frameNo, task->surface,
-                                                   task->keepAspectRatio);
-            task->sender.set_value(result);
-        }
+// the frames are spread over both renderers when pipelining, and over the
+// clones of renderFrames().
+RenderStats AnimationImpl::renderStats() const
+{
+    finishPrefetch();
+
+    RenderStats stats;
+    mRenderer->stats(stats);
+    stats.parseTime = mParseTime;
+    if (mNextRenderer) {
+        RenderStats other;
+        mNextRenderer->stats(other);
+        addStats(stats, other);
     }
+    if (mBatchStats) {
+        std::lock_guard<std::mutex> lock(mBatchStats->mutex);
+        addStats(stats, mBatchStats->stats);
+    }
+    return stats;
+}
 
-    RenderTaskScheduler()
-    {
-        for (unsigned n = 0; n != _count; ++n) {
-            _threads.emplace_back([&, n] { run(n); });
-        }
+void AnimationImpl::resetRenderStats()
+{
+    finishPrefetch();
+    mRenderer->resetStats();
+    if (mNextRenderer) mNextRenderer->resetStats();
+    if (mBatchStats) {
+        std::lock_guard<std::mutex> lock(mBatchStats->mutex);
+        mBatchStats->stats = RenderStats();
     }
+}
 
-public:
-    static RenderTaskScheduler &instance()
-    {
-        static RenderTaskScheduler singleton;
-        return singleton;
+void AnimationImpl::setValue(const std::string &keypath, LOTVariant &&value)
+{
+    if (keypath.empty()) return;
+    finishPrefetch();
+    mRenderer->setValue(keypath, value);
+    if (mNextRenderer) {
+        mNextRenderer->setValue(keypath, value);
+        mNextRenderer->invalidate();
     }
 
-    ~RenderTaskScheduler()
-    {
-        for (auto &e : _q) e.done();
+    // a property driven every frame keeps one entry, it moves to the back
+    // so the replay still applies overlapping keypaths in call order.
+    auto prop = value.property();
+    mValues.erase(std::remove_if(mValues.begin(), mValues.end(),
+                                 [&](const std::pair<std::string, LOTVariant> &e) {
+                                     return e.second.property() == prop &&
+                                            e.first == keypath;
+                                 }),
+                  mValues.end());
+    mValues.emplace_back(keypath, std::move(value));
+}
 
-        for (auto &e : _threads) e.join();
+const LOTLayerNode *AnimationImpl::renderTree(size_t frameNo, const VSize &size)
+{
+    if (update(frameNo, size, true)) {
+        mRenderer->buildRenderTree();
     }
+    return mRenderer->renderTree();
+}
 
-    std::future<Surface> process(SharedRenderTask task)
-    {
-        auto receiver = std::move(task->receiver);
-        auto i = _index++;
+bool AnimationImpl::update(size_t frameNo, const VSize &size,
+                           bool keepAspectRatio)
+{
+    return mRenderer->update(modelFrame(frameNo), size, keepAspectRatio);
+}
 
-        for (unsigned n = 0; n != _count; ++n) {
-            if (_q[(i + n) % _count].try_push(std::move(task))) return receiver;
-        }
+Surface AnimationImpl::render(size_t frameNo, const Surface &surface,
+                              bool keepAspectRatio)
+{
+    bool renderInProgress = mRenderInProgress.load();
+    if (renderInProgress) {
+        vCritical << "Already Rendering Scheduled for this Animation";
+        return surface;
+    }
 
-        if (_count > 0) {
-            _q[i % _count].push(std::move(task));
-        }
+    mRenderInProgress.store(true);
+    VSize size(int(surface.drawRegionWidth()), int(surface.drawRegionHeight()));
+    if (finishPrefetch(frameNo, size, keepAspectRatio))
+        std::swap(mRenderer, mNextRenderer);
+    update(frameNo, size, keepAspectRatio);
 
-        return receiver;
-    }
-};
+    // evaluate the next frame while this one is drawn.
+    if (mNextRenderer) startPrefetch(frameNo, size, keepAspectRatio);
 
-#else
-class RenderTaskScheduler {
-public:
-    static RenderTaskScheduler &instance()
-    {
-        static RenderTaskScheduler singleton;
-        return singleton;
-    }
+    Surface result = surface;
+    mRenderer->render(result);
+    mRenderInProgress.store(false);
 
-    std::future<Surface> process(SharedRenderTask task)
-    {
-        auto result = task->playerImpl->render(task->frameNo, task->surface,
-                                               task->keepAspectRatio);
-        task->sender.set_value(result);
-        return std::move(task->receiver);
-    }
-};
-#endif
+    return result;
+}
 
-std::future<Surface> AnimationImpl::renderAsync(size_t    frameNo,
-                                                Surface &&surface,
-                                                bool      keepAspectRatio)
+void AnimationImpl::init(std::shared_ptr<model::Composition> composition,
+                         double                              parseTime)
 {
-    if (!mTask) {
-        mTask = std::make_shared<RenderTask>();
-    } else {
-        mTask->sender = std::promise<Surface>();
-        mTask->receiver = mTask->sender.get_future();
+    mParseTime = parseTime;
+    mComposition = composition;
+    mModel = composition.get();
+    mRenderer = std::make_unique<renderer::Composition>(composition);
+    mRenderInProgress = false;
+}
+
+RenderTicket AnimationImpl::render(
+    size_t frameNo, Surface &&surface, RenderPriority priority,
+    std::chrono::steady_clock::time_point deadline, bool keepAspectRatio)
+{
+    auto task = std::make_shared<RenderTask>();
+    task->playerImpl = this;
+    task->frameNo = frameNo;
+    task->surface = std::move(surface);
+    task->keepAspectRatio = keepAspectRatio;
+    task->priority = priority;
+    task->deadline = deadline;
+
+    RenderTicket ticket;
+    ticket.mTask = task;
+    ticket.mFuture = task->sender.get_future();
+    RenderQueue::instance().push(std::move(task));
+    return ticket;
+}
+
+std::vector<std::future<Surface>> AnimationImpl::renderFrames(
+    size_t firstFrame, std::vector<Surface> &&surfaces,
+    Animation::FrameCallback &&callback, bool keepAspectRatio)
+{
+    auto batch = std::make_shared<FrameBatch>();
+    batch->composition = mComposition;
+    batch->values = mValues;
+    batch->callback = std::move(callback);
+    batch->firstFrame = firstFrame;
+    batch->keepAspectRatio = keepAspectRatio;
+    batch->tiling = mTiling;
+    if (mProfiling) batch->stats = mBatchStats;
+    batch->surfaces = std::move(surfaces);
+    batch->results.resize(batch->surfaces.size());
+
+    std::vector<std::future<Surface>> receivers;
+    receivers.reserve(batch->surfaces.size());
+    for (size_t i = 0; i < batch->surfaces.size(); i++) {
+        batch->frames.push_back(modelFrame(firstFrame + i));
+        receivers.push_back(batch->results[i].get_future());
     }
-    mTask->playerImpl = this;
-    mTask->frameNo = frameNo;
-    mTask->surface = std::move(surface);
-    mTask->keepAspectRatio = keepAspectRatio;
 
-    return RenderTaskScheduler::instance().process(mTask);
+    // consecutive frames mostly land on the same renderer, which then only
+    // updates what changed between them.
+    VTaskScheduler::instance().processBatch(
+        batch->surfaces.size(), [batch](size_t i) { batch->render(i); });
+    return receivers;
 }
 
 /**
@@ -262,11 +678,35 @@ std::unique_ptr<Animation> Animation::loadFromData(
         return nullptr;
     }
 
+    VElapsedTimer timer;
+    timer.start();
     auto composition = model::loadFromData(std::move(jsonData), key,
                                            resourcePath, cachePolicy);
     if (composition) {
         auto animation = std::unique_ptr<Animation>(new Animation);
-        animation->d->init(std::move(composition));
+        animation->d->init(std::move(composition), timer.elapsed());
+        return animation;
+    }
+
+    return nullptr;
+}
+
+std::unique_ptr<Animation> Animation::loadFromData(
+    char *data, size_t size, const std::string &key,
+    const std::string &resourcePath, bool cachePolicy)
+{
+    if (!data || !size) {
+        vWarning << "jason data is empty";
+        return nullptr;
+    }
+
+    VElapsedTimer timer;
+    timer.start();
+    auto composition =
+        model::loadFromData(data, size, key, resourcePath, cachePolicy);
+    if (composition) {
+        auto animation = std::unique_ptr<Animation>(new Animation);
+        animation->d->init(std::move(composition), timer.elapsed());
         return animation;
     }
 
@@ -282,11 +722,13 @@ std::unique_ptr<Animation> Animation::loadFromData(std::string jsonData,
         return nullptr;
     }
 
+    VElapsedTimer timer;
+    timer.start();
     auto composition = model::loadFromData(
         std::move(jsonData), std::move(resourcePath), std::move(filter));
     if (composition) {
         auto animation = std::unique_ptr<Animation>(new Animation);
-        animation->d->init(std::move(composition));
+        animation->d->init(std::move(composition), timer.elapsed());
         return animation;
     }
     return nullptr;
@@ -300,10 +742,12 @@ std::unique_ptr<Animation> Animation::loadFromFile(const std::string &path,
         return nullptr;
     }
 
+    VElapsedTimer timer;
+    timer.start();
     auto composition = model::loadFromFile(path, cachePolicy);
     if (composition) {
         auto animation = std::unique_ptr<Animation>(new Animation);
-        animation->d->init(std::move(composition));
+        animation->d->init(std::move(composition), timer.elapsed());
         return animation;
     }
     return nullptr;
@@ -337,6 +781,31 @@ size_t Animation::frameAtPos(double pos)
     return d->frameAtPos(pos);
 }
 
+void Animation::setProfiling(bool enable)
+{
+    d->setProfiling(enable);
+}
+
+RenderStats Animation::renderStats() const
+{
+    return d->renderStats();
+}
+
+void Animation::resetRenderStats()
+{
+    d->resetRenderStats();
+}
+
+void Animation::setPipelining(bool enable)
+{
+    d->setPipelining(enable);
+}
+
+void Animation::setTiledRendering(bool enable)
+{
+    d->setTiledRendering(enable);
+}
+
 const LOTLayerNode *Animation::renderTree(size_t frameNo, size_t width,
                                           size_t height) const
 {
@@ -346,7 +815,28 @@ const LOTLayerNode *Animation::renderTree(size_t frameNo, size_t width,
 std::future<Surface> Animation::render(size_t frameNo, Surface surface,
                                        bool keepAspectRatio)
 {
-    return d->renderAsync(frameNo, std::move(surface), keepAspectRatio);
+    return std::move(d->render(frameNo, std::move(surface),
+                               RenderPriority::Visible,
+                               std::chrono::steady_clock::time_point::max(),
+                               keepAspectRatio)
+                         .future());
+}
+
+RenderTicket Animation::render(size_t frameNo, Surface surface,
+                               RenderPriority                        priority,
+                               std::chrono::steady_clock::time_point deadline,
+                               bool keepAspectRatio)
+{
+    return d->render(frameNo, std::move(surface), priority, deadline,
+                     keepAspectRatio);
+}
+
+std::vector<std::future<Surface>> Animation::renderFrames(
+    size_t firstFrame, std::vector<Surface> surfaces, FrameCallback callback,
+    bool keepAspectRatio)
+{
+    return d->renderFrames(firstFrame, std::move(surfaces),
+                           std::move(callback), keepAspectRatio);
 }
 
 void Animation::renderSync(size_t frameNo, Surface surface,
@@ -355,6 +845,11 @@ void Animation::renderSync(size_t frameNo, Surface surface,
     d->render(frameNo, surface, keepAspectRatio);
 }
 
+std::string Animation::serialize() const
+{
+    return d->serialize();
+}
+
 const LayerInfoList &Animation::layers() const
 {
     return d->layerInfoList();
@@ -417,6 +912,22 @@ void Animation::setValue(Point_Type, Property prop, const std::string &keypath,
     d->setValue(keypath, LOTVariant(prop, value));
 }
 
+bool RenderTicket::cancel()
+{
+    if (!mTask) return false;
+
+    int queued = RenderTask::Queued;
+    if (!mTask->state.compare_exchange_strong(queued, RenderTask::Dropped))
+        return false;
+    mTask->drop();
+    return true;
+}
+
+bool RenderTicket::cancelled() const
+{
+    return mTask && mTask->state == RenderTask::Dropped;
+}
+
 Animation::~Animation() = default;
 Animation::Animation() : d(std::make_unique<AnimationImpl>()) {}
 
@@ -429,6 +940,8 @@ Surface::Surface(uint32_t *buffer, size_t width, size_t height,
 {
     mDrawArea.w = mWidth;
     mDrawArea.h = mHeight;
+    mClearArea = mDrawArea;
+    mDirtyArea = mDrawArea;
 }
 
 void Surface::setDrawRegion(size_t x, size_t y, size_t width, size_t height)
@@ -441,6 +954,24 @@ void Surface::setDrawRegion(size_t x, size_t y, size_t width, size_t height)
     mDrawArea.h = height;
 }
 
+void Surface::setClearRegion(size_t x, size_t y, size_t width, size_t height)
+{
+    if ((x + width > mWidth) || (y + height > mHeight)) return;
+
+    mClearArea.x = x;
+    mClearArea.y = y;
+    mClearArea.w = width;
+    mClearArea.h = height;
+}
+
+void Surface::setDirtyRegion(size_t x, size_t y, size_t width, size_t height)
+{
+    mDirtyArea.x = x;
+    mDirtyArea.y = y;
+    mDirtyArea.w = width;
+    mDirtyArea.h = height;
+}
+
 #ifdef LOTTIE_LOGGING_SUPPORT
 void initLogging()
 {
@@ -22,12 +22,18 @@
 
 #include "lottieitem.h"
 #include <algorithm>
+#include <climits>
 #include <cmath>
 #include <iterator>
 #include "lottiekeypath.h"
 #include "vbitmap.h"
+#include "vdrawhelper.h"
+#include "velapsedtimer.h"
 #include "vpainter.h"
 #include "vraster.h"
+#include "vtaskscheduler.h"
+
+#include <condition_variable>
 
 /* Lottie Layer Rules
  * 1. time stretch is pre calculated and applied to all the properties of the
@@ -97,6 +103,26 @@ static renderer::Layer *createLayerItem(model::Layer *layerData,
     }
 }
 
+namespace {
+// adds the time spent in its scope to value when profiling is enabled.
+class ProfileScope {
+public:
+    ProfileScope(bool enabled, double &value)
+        : mValue(enabled ? &value : nullptr)
+    {
+        if (mValue) mTimer.start();
+    }
+    ~ProfileScope()
+    {
+        if (mValue) *mValue += mTimer.elapsed();
+    }
+
+private:
+    double *      mValue;
+    VElapsedTimer mTimer;
+};
+}  // namespace
+
 renderer::Composition::Composition(std::shared_ptr<model::Composition> model)
     : mCurFrameNo(-1)
 {
@@ -125,11 +151,19 @@ bool renderer::Composition::update(int frameNo, const VSize &size,
     mCurFrameNo = frameNo;
     mKeepAspectRatio = keepAspectRatio;
 
-    /*
-     * if viewbox dosen't scale exactly to the viewport
-     * we scale the viewbox keeping AspectRatioPreserved and then align the
-     * viewbox to the viewport using AlignCenter rule.
-     */
+    ProfileScope scope(mProfiling, mStats.updateTime);
+    mRootLayer->update(frameNo, rootMatrix(VPoint()), 1.0);
+    return true;
+}
+
+/*
+ * if viewbox dosen't scale exactly to the viewport
+ * we scale the viewbox keeping AspectRatioPreserved and then align the
+ * viewbox to the viewport using AlignCenter rule.
+ * offset is the point of the viewport that lands at the origin.
+ */
+VMatrix renderer::Composition::rootMatrix(const VPoint &offset) const
+{
     VMatrix m;
     VSize   viewPort = mViewSize;
     VSize   viewBox = mModel->size();
@@ -139,35 +173,202 @@ bool renderer::Composition::update(int frameNo, const VSize &size,
         float scale = std::min(sx, sy);
         float tx = (viewPort.width() - viewBox.width() * scale) * 0.5f;
         float ty = (viewPort.height() - viewBox.height() * scale) * 0.5f;
-        m.translate(tx, ty).scale(scale, scale);
+        m.translate(tx - offset.x(), ty - offset.y()).scale(scale, scale);
     } else {
-        m.scale(sx, sy);
+        m.translate(-offset.x(), -offset.y()).scale(sx, sy);
     }
-    mRootLayer->update(frameNo, m, 1.0);
-    return true;
+    return m;
+}
+
+void renderer::Composition::setProfiling(bool enable)
+{
+    mProfiling = enable;
+    mRootLayer->setProfiling(enable);
+}
+
+void renderer::Composition::stats(rlottie::RenderStats &stats) const
+{
+    stats.updateTime = mStats.updateTime;
+    stats.rasterTime = mStats.rasterTime;
+    stats.paintTime = mStats.paintTime;
+    stats.convertTime = mStats.convertTime;
+    stats.frameCount = mStats.frameCount;
+
+    LayerStats total;
+    mRootLayer->collectStats(total);
+    stats.spanCount = total.spanCount;
+    stats.maskCount = total.maskCount;
+    stats.matteCount = total.matteCount;
+
+    stats.layers.clear();
+    mRootLayer->collectChildStats(stats.layers);
 }
 
-bool renderer::Composition::render(const rlottie::Surface &surface)
+void renderer::Composition::resetStats()
+{
+    mStats = rlottie::RenderStats();
+    mRootLayer->resetStats();
+}
+
+// VRle::Span coordinates are 16 bit.
+static constexpr int maxRegionSize = SHRT_MAX;
+
+bool renderer::Composition::render(rlottie::Surface &surface)
 {
     mSurface.reset(reinterpret_cast<uchar *>(surface.buffer()),
                    uint(surface.width()), uint(surface.height()),
                    uint(surface.bytesPerLine()),
                    VBitmap::Format::ARGB32_Premultiplied);
 
+    if (mProfiling) mStats.frameCount++;
+
+    VPainter painter;
+    painter.begin(&mSurface, VRect(int(surface.clearRegionPosX()),
+                                   int(surface.clearRegionPosY()),
+                                   int(surface.clearRegionWidth()),
+                                   int(surface.clearRegionHeight())));
+    painter.end();
+
+    // sub surface area for drawing.
+    VRect region(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
+                 int(surface.drawRegionWidth()), int(surface.drawRegionHeight()));
+
+    VRect dirty;
+    if (region.width() <= maxRegionSize && region.height() <= maxRegionSize) {
+        dirty = renderRegion(region);
+    } else {
+        // larger regions are drawn in pieces, with the content moved so
+        // each piece starts at the origin.
+        for (int y = 0; y < region.height(); y += maxRegionSize) {
+            for (int x = 0; x < region.width(); x += maxRegionSize) {
+                // update() already laid out the first piece, updating again
+                // with the same matrix would clear the layers' dirty flags.
+                if (x || y) {
+                    ProfileScope scope(mProfiling, mStats.updateTime);
+                    mRootLayer->update(mCurFrameNo, rootMatrix(VPoint(x, y)),
+                                       1.0);
+                }
+                VRect piece(region.x() + x, region.y() + y,
+                            std::min(maxRegionSize, region.width() - x),
+                            std::min(maxRegionSize, region.height() - y));
+                dirty = dirty.united(renderRegion(piece));
+            }
+        }
+        // the layers hold the last piece, the next update() starts over.
+        invalidate();
+    }
+    surface.setDirtyRegion(size_t(dirty.x()), size_t(dirty.y()),
+                           size_t(dirty.width()), size_t(dirty.height()));
+
+    // pixels outside the dirty region are transparent in every format.
+    using Format = rlottie::Surface::Format;
+    if (surface.format() == Format::ARGB32_Premultiplied) return true;
+
+    ProfileScope scope(mProfiling, mStats.convertTime);
+    bool swapRB = surface.format() != Format::ARGB32;
+    for (int y = dirty.top(); y < dirty.bottom(); y++) {
+        uint32_t *pixels =
+            reinterpret_cast<uint32_t *>(mSurface.data() + y * mSurface.stride()) +
+            dirty.left();
+        if (surface.format() == Format::ABGR32_Premultiplied)
+            memswaprb32(pixels, dirty.width());
+        else
+            memunpremultiply32(pixels, dirty.width(), swapRB);
+    }
+    return true;
+}
+
+// rasterizes the frame for region of the surface and paints it there,
+// returns the area it touched.
+VRect renderer::Composition::renderRegion(const VRect &region)
+{
     /* schedule all preprocess task for this frame at once.
      */
-    VRect clip(0, 0, int(surface.drawRegionWidth()),
-               int(surface.drawRegionHeight()));
-    mRootLayer->preprocess(clip);
+    VRect clip(0, 0, region.width(), region.height());
+    {
+        ProfileScope scope(mProfiling, mStats.rasterTime);
+        VRasterBatch batch;
+        mRootLayer->preprocess(clip);
+    }
 
-    VPainter painter(&mSurface);
-    // set sub surface area for drawing.
-    painter.setDrawRegion(
-        VRect(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
-              int(surface.drawRegionWidth()), int(surface.drawRegionHeight())));
+    size_t tiles = tileCount(region.size());
+    if (tiles > 1) return renderTiles(region, tiles);
+
+    ProfileScope scope(mProfiling, mStats.paintTime);
+    VPainter     painter;
+    painter.begin(&mSurface, VRect());
+    painter.setDrawRegion(region);
     mRootLayer->render(&painter, {}, {}, mSurfaceCache);
     painter.end();
-    return true;
+    return painter.dirtyRect();
+}
+
+// bands of at least 128 rows, as many as there are threads. Profiled frames
+// paint in one piece, the layer counters aren't shared between threads.
+size_t renderer::Composition::tileCount(const VSize &size) const
+{
+    if (!mTiling || mProfiling) return 1;
+    if (size.width() * size.height() < 512 * 512) return 1;
+
+    size_t threads = VTaskScheduler::instance().threadCount();
+    return std::max<size_t>(
+        1, std::min<size_t>(threads, size_t(size.height()) / 128));
+}
+
+// paints the frame rasterized by preprocess() in horizontal bands, each
+// clipped to its rows, returns the area they touched.
+VRect renderer::Composition::renderTiles(const VRect &region, size_t count)
+{
+    struct Tiles {
+        std::mutex              mutex;
+        std::condition_variable cv;
+        size_t                  pending;
+        std::vector<VRect>      dirty;
+    };
+    auto tiles = std::make_shared<Tiles>();
+    tiles->pending = count;
+    tiles->dirty.resize(count);
+    if (mTileCaches.size() < count) mTileCaches.resize(count);
+
+    int rows = (region.height() + int(count) - 1) / int(count);
+    VTaskScheduler::instance().processBatch(
+        count, [this, tiles, region, rows](size_t i) {
+            VPainter painter;
+            painter.begin(&mSurface, VRect());
+            painter.setDrawRegion(region);
+            painter.setClipRect(VRect(0, int(i) * rows, region.width(), rows));
+            mRootLayer->render(&painter, {}, {}, mTileCaches[i]);
+            painter.end();
+
+            std::lock_guard<std::mutex> lock(tiles->mutex);
+            tiles->dirty[i] = painter.dirtyRect();
+            if (--tiles->pending == 0) tiles->cv.notify_all();
+        });
+
+    std::unique_lock<std::mutex> lock(tiles->mutex);
+    while (tiles->pending) {
+        lock.unlock();
+        bool helped = VTaskScheduler::instance().runPending();
+        lock.lock();
+        if (!helped && tiles->pending) tiles->cv.wait(lock);
+    }
+
+    VRect dirty;
+    for (const auto &rect : tiles->dirty) dirty = dirty.united(rect);
+    return dirty;
+}
+
+// layer buffers cover the clip of the painter they are drawn into, which is a
+// band of the frame when it is painted in tiles.
+static void beginLayerBuffer(VPainter &painter, VBitmap &buffer,
+                             const VPainter &target)
+{
+    VRect clip = target.clipBoundingRect();
+    VRect draw = target.drawRect();
+    painter.begin(&buffer);
+    painter.setDrawRegion(
+        VRect(-clip.x(), -clip.y(), draw.width(), draw.height()));
+    painter.setClipRect(clip);
 }
 
 void renderer::Mask::update(int frameNo, const VMatrix &parentMatrix,
@@ -216,13 +417,14 @@ void renderer::Mask::preprocess(const VRect &clip)
 void renderer::Layer::render(VPainter *painter, const VRle &inheritMask,
                              const VRle &matteRle, SurfaceCache &)
 {
-    auto renderlist = renderList();
+    auto renderlist = drawList();
 
     if (renderlist.empty()) return;
 
     VRle mask;
     if (mLayerMask) {
-        mask = mLayerMask->maskRle(painter->clipBoundingRect());
+        if (mProfiling) mStats.maskCount++;
+        mask = mLayerMask->maskRle(painter->drawRect());
         if (!inheritMask.empty()) mask = mask & inheritMask;
         // if resulting mask is empty then return.
         if (mask.empty()) return;
@@ -233,6 +435,7 @@ void renderer::Layer::render(VPainter *painter, const VRle &inheritMask,
     for (auto &i : renderlist) {
         painter->setBrush(i->mBrush);
         VRle rle = i->rle();
+        if (mProfiling) mStats.spanCount += rle.spanCount();
         if (matteRle.empty()) {
             if (mask.empty()) {
                 // no mask no matte
@@ -289,6 +492,11 @@ void renderer::LayerMask::update(int frameNo, const VMatrix &parentMatrix,
 
 VRle renderer::LayerMask::maskRle(const VRect &clipRect)
 {
+    // waiting with the lock held could run another tile of the frame on this
+    // thread, so the masks are waited for first.
+    for (auto &e : mMasks) e.rle();
+
+    std::lock_guard<std::mutex> lock(mMutex);
     if (!mDirty) return mRle;
 
     VRle rle;
@@ -500,13 +708,13 @@ void renderer::CompLayer::render(VPainter *painter, const VRle &inheritMask,
         renderHelper(painter, inheritMask, matteRle, cache);
     } else {
         if (complexContent()) {
-            VSize    size = painter->clipBoundingRect().size();
+            VRect    clip = painter->clipBoundingRect();
             VPainter srcPainter;
-            VBitmap srcBitmap = cache.make_surface(size.width(), size.height());
-            srcPainter.begin(&srcBitmap);
+            VBitmap srcBitmap = cache.make_surface(clip.width(), clip.height());
+            beginLayerBuffer(srcPainter, srcBitmap, *painter);
             renderHelper(&srcPainter, inheritMask, matteRle, cache);
             srcPainter.end();
-            painter->drawBitmap(VPoint(), srcBitmap,
+            painter->drawBitmap(VPoint(clip.x(), clip.y()), srcBitmap,
                                 uchar(combinedAlpha() * 255.0f));
             cache.release_surface(srcBitmap);
         } else {
@@ -522,7 +730,8 @@ void renderer::CompLayer::renderHelper(VPainter *    painter,
 {
     VRle mask;
     if (mLayerMask) {
-        mask = mLayerMask->maskRle(painter->clipBoundingRect());
+        if (mProfiling) mStats.maskCount++;
+        mask = mLayerMask->maskRle(painter->drawRect());
         if (!inheritMask.empty()) mask = mask & inheritMask;
         // if resulting mask is empty then return.
         if (mask.empty()) return;
@@ -541,10 +750,13 @@ void renderer::CompLayer::renderHelper(VPainter *    painter,
             matte = layer;
         } else {
             if (layer->visible()) {
+                ProfileScope scope(mProfiling, layer->stats().renderTime);
                 if (matte) {
-                    if (matte->visible())
+                    if (matte->visible()) {
+                        if (mProfiling) layer->stats().matteCount++;
                         renderMatteLayer(painter, mask, matteRle, matte, layer,
                                          cache);
+                    }
                 } else {
                     layer->render(painter, mask, matteRle, cache);
                 }
@@ -554,25 +766,62 @@ void renderer::CompLayer::renderHelper(VPainter *    painter,
     }
 }
 
+void renderer::Layer::collectStats(LayerStats &stats) const
+{
+    stats.spanCount += mStats.spanCount;
+    stats.maskCount += mStats.maskCount;
+    stats.matteCount += mStats.matteCount;
+}
+
+void renderer::CompLayer::collectStats(LayerStats &stats) const
+{
+    Layer::collectStats(stats);
+    for (const auto &layer : mLayers) layer->collectStats(stats);
+}
+
+void renderer::CompLayer::collectChildStats(
+    std::vector<rlottie::RenderStats::Layer> &list) const
+{
+    for (const auto &layer : mLayers) {
+        LayerStats total;
+        layer->collectStats(total);
+
+        rlottie::RenderStats::Layer info;
+        info.name = layer->name() ? layer->name() : "";
+        info.updateTime = layer->stats().updateTime;
+        info.renderTime = layer->stats().renderTime;
+        info.spanCount = total.spanCount;
+        info.maskCount = total.maskCount;
+        info.matteCount = total.matteCount;
+        list.push_back(std::move(info));
+    }
+}
+
+void renderer::CompLayer::resetStats()
+{
+    Layer::resetStats();
+    for (const auto &layer : mLayers) layer->resetStats();
+}
+
 void renderer::CompLayer::renderMatteLayer(VPainter *painter, const VRle &mask,
                                            const VRle &     matteRle,
                                            renderer::Layer *layer,
                                            renderer::Layer *src,
                                            SurfaceCache &   cache)
 {
-    VSize size = painter->clipBoundingRect().size();
+    VRect clip = painter->clipBoundingRect();
     // Decide if we can use fast matte.
     // 1. draw src layer to matte buffer
     VPainter srcPainter;
-    VBitmap  srcBitmap = cache.make_surface(size.width(), size.height());
-    srcPainter.begin(&srcBitmap);
+    VBitmap  srcBitmap = cache.make_surface(clip.width(), clip.height());
+    beginLayerBuffer(srcPainter, srcBitmap, *painter);
     src->render(&srcPainter, mask, matteRle, cache);
     srcPainter.end();
 
     // 2. draw layer to layer buffer
     VPainter layerPainter;
-    VBitmap  layerBitmap = cache.make_surface(size.width(), size.height());
-    layerPainter.begin(&layerBitmap);
+    VBitmap  layerBitmap = cache.make_surface(clip.width(), clip.height());
+    beginLayerBuffer(layerPainter, layerBitmap, *painter);
     layer->render(&layerPainter, mask, matteRle, cache);
 
     // 2.1update composition mode
@@ -598,10 +847,10 @@ void renderer::CompLayer::renderMatteLayer(VPainter *painter, const VRle &mask,
     }
 
     // 2.3 draw src buffer as mask
-    layerPainter.drawBitmap(VPoint(), srcBitmap);
+    layerPainter.drawBitmap(VPoint(clip.x(), clip.y()), srcBitmap);
     layerPainter.end();
     // 3. draw the result buffer into painter
-    painter->drawBitmap(VPoint(), layerBitmap);
+    painter->drawBitmap(VPoint(clip.x(), clip.y()), layerBitmap);
 
     cache.release_surface(srcBitmap);
     cache.release_surface(layerBitmap);
@@ -626,8 +875,11 @@ VRle renderer::Clipper::rle(const VRle &mask)
 {
     if (mask.empty()) return mRasterizer.rle();
 
+    VRle clip = mRasterizer.rle();  // outside the lock, see maskRle()
+
+    std::lock_guard<std::mutex> lock(mMutex);
     mMaskedRle.clone(mask);
-    mMaskedRle &= mRasterizer.rle();
+    mMaskedRle &= clip;
     return mMaskedRle;
 }
 
@@ -640,6 +892,8 @@ void renderer::CompLayer::updateContent()
     float alpha = combinedAlpha();
     if (complexContent()) alpha = 1;
     for (const auto &layer : mLayers) {
+        layer->setProfiling(mProfiling);
+        ProfileScope scope(mProfiling, layer->stats().updateTime);
         layer->update(mappedFrame, combinedMatrix(), alpha);
     }
 }
@@ -853,6 +1107,14 @@ renderer::DrawableList renderer::ShapeLayer::renderList()
     return {mDrawableList.data(), mDrawableList.size()};
 }
 
+// preprocessStage() built the list for this frame.
+renderer::DrawableList renderer::ShapeLayer::drawList()
+{
+    if (skipRendering() || mDrawableList.empty()) return {};
+
+    return {mDrawableList.data(), mDrawableList.size()};
+}
+
 bool renderer::Group::resolveKeyPath(LOTKeyPath &keyPath, uint depth,
                                      LOTVariant &value)
 {
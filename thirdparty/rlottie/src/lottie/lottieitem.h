@@ -24,6 +24,7 @@
 #define LOTTIEITEM_H
 
 #include <memory>
+#include <mutex>
 #include <sstream>
 
 #include "lottiekeypath.h"
@@ -143,6 +144,7 @@ public:
 public:
     VSize       mSize;
     VPath       mPath;
+    std::mutex  mMutex;  // tiles of a frame ask at once
     VRle        mMaskedRle;
     VRasterizer mRasterizer;
     bool        mRasterRequest{false};
@@ -180,6 +182,7 @@ public:
 
 public:
     std::vector<Mask> mMasks;
+    std::mutex        mMutex;  // tiles of a frame ask at once
     VRle              mRle;
     bool              mStatic{true};
     bool              mDirty{true};
@@ -187,6 +190,14 @@ public:
 
 class Layer;
 
+struct LayerStats {
+    double updateTime{0};
+    double renderTime{0};
+    size_t spanCount{0};
+    size_t maskCount{0};
+    size_t matteCount{0};
+};
+
 class Composition {
 public:
     explicit Composition(std::shared_ptr<model::Composition> composition);
@@ -194,11 +205,24 @@ public:
     VSize size() const { return mViewSize; }
     void  buildRenderTree();
     const LOTLayerNode *renderTree() const;
-    bool                render(const rlottie::Surface &surface);
+    bool                render(rlottie::Surface &surface);
     void                setValue(const std::string &keypath, LOTVariant &value);
+    void                setProfiling(bool enable);
+    void                stats(rlottie::RenderStats &stats) const;
+    void                resetStats();
+    // forgets the evaluated frame, the next update() evaluates again.
+    void                invalidate() { mCurFrameNo = -1; }
+    // paints large frames in horizontal bands on the thread pool.
+    void                setTiling(bool enable) { mTiling = enable; }
 
 private:
+    VMatrix rootMatrix(const VPoint &offset) const;
+    VRect   renderRegion(const VRect &region);
+    size_t  tileCount(const VSize &size) const;
+    VRect   renderTiles(const VRect &region, size_t count);
+
     SurfaceCache                        mSurfaceCache;
+    std::vector<SurfaceCache>           mTileCaches;
     VBitmap                             mSurface;
     VMatrix                             mScaleMatrix;
     VSize                               mViewSize;
@@ -207,6 +231,9 @@ private:
     VArenaAlloc                         mAllocator{2048};
     int                                 mCurFrameNo;
     bool                                mKeepAspectRatio{true};
+    bool                                mProfiling{false};
+    bool                                mTiling{false};
+    rlottie::RenderStats                mStats;
 };
 
 class Layer {
@@ -224,6 +251,8 @@ public:
     VMatrix      matrix(int frameNo) const;
     void         preprocess(const VRect &clip);
     virtual DrawableList renderList() { return {}; }
+    // what render() draws. Only read, so the tiles of a frame can share it.
+    virtual DrawableList drawList() { return renderList(); }
     virtual void         render(VPainter *painter, const VRle &mask,
                                 const VRle &matteRle, SurfaceCache &cache);
     bool                 hasMatte()
@@ -241,6 +270,12 @@ public:
     const char *                 name() const { return mLayerData->name(); }
     virtual bool                 resolveKeyPath(LOTKeyPath &keyPath, uint depth,
                                                 LOTVariant &value);
+    void                         setProfiling(bool value) { mProfiling = value; }
+    LayerStats &                 stats() { return mStats; }
+    // adds the span/mask/matte counts of this layer and its children.
+    virtual void                 collectStats(LayerStats &stats) const;
+    virtual void collectChildStats(std::vector<rlottie::RenderStats::Layer> &) const {}
+    virtual void                 resetStats() { mStats = LayerStats(); }
 
 protected:
     virtual void   preprocessStage(const VRect &clip) = 0;
@@ -265,6 +300,8 @@ protected:
     int                        mFrameNo{-1};
     DirtyFlag                  mDirtyFlag{DirtyFlagBit::All};
     bool                       mComplexContent{false};
+    bool                       mProfiling{false};
+    LayerStats                 mStats;
     std::unique_ptr<CApiData>  mCApiData;
 };
 
@@ -277,6 +314,10 @@ public:
     void buildLayerNode() final;
     bool resolveKeyPath(LOTKeyPath &keyPath, uint depth,
                         LOTVariant &value) override;
+    void collectStats(LayerStats &stats) const final;
+    void collectChildStats(
+        std::vector<rlottie::RenderStats::Layer> &list) const final;
+    void resetStats() final;
 
 protected:
     void preprocessStage(const VRect &clip) final;
@@ -316,6 +357,7 @@ class ShapeLayer final : public Layer {
 public:
     explicit ShapeLayer(model::Layer *layerData, VArenaAlloc *allocator);
     DrawableList renderList() final;
+    DrawableList drawList() final;
     void         buildLayerNode() final;
     bool         resolveKeyPath(LOTKeyPath &keyPath, uint depth,
                                 LOTVariant &value) override;
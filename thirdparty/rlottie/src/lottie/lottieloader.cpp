@@ -20,19 +20,45 @@
  * SOFTWARE.
  */
 
+#include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 #include "lottiemodel.h"
+#include "rlottie.h"
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif  // _WIN32
 
 using namespace rlottie::internal;
 
 #ifdef LOTTIE_CACHE_SUPPORT
 
+#include <atomic>
+#include <limits>
+#include <list>
 #include <mutex>
 #include <unordered_map>
 
+/*
+ * Models are kept in most recently used order, the least recently used ones
+ * are evicted once either the entry count or the bytes the models take
+ * exceed their limit.
+ */
 class ModelCache {
 public:
     static ModelCache &instance()
@@ -44,39 +70,98 @@ public:
     {
         std::lock_guard<std::mutex> guard(mMutex);
 
-        if (!mcacheSize) return nullptr;
+        if (!enabled()) return nullptr;
 
         auto search = mHash.find(key);
-
-        return (search != mHash.end()) ? search->second : nullptr;
+        if (search == mHash.end()) {
+            mStats.misses++;
+            return nullptr;
+        }
+
+        mStats.hits++;
+        mEntries.splice(mEntries.begin(), mEntries, search->second);
+        return search->second->value;
     }
     void add(const std::string &key, std::shared_ptr<model::Composition> value)
     {
         std::lock_guard<std::mutex> guard(mMutex);
 
-        if (!mcacheSize) return;
+        if (!enabled()) return;
 
-        //@TODO just remove the 1st element
-        // not the best of LRU logic
-        if (mcacheSize == mHash.size()) mHash.erase(mHash.cbegin());
-
-        mHash[key] = std::move(value);
+        auto search = mHash.find(key);
+        if (search != mHash.end()) {
+            mBytes -= search->second->bytes;
+            mEntries.erase(search->second);
+            mHash.erase(search);
+        }
+
+        size_t bytes = value->footprint();
+        if (bytes > mBudget) return;
+
+        mEntries.push_front({key, std::move(value), bytes});
+        mHash[key] = mEntries.begin();
+        mBytes += bytes;
+        trim();
     }
 
     void configureCacheSize(size_t cacheSize)
     {
         std::lock_guard<std::mutex> guard(mMutex);
         mcacheSize = cacheSize;
+        trim();
+    }
+
+    void configureBudget(size_t budget)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mBudget = budget;
+        trim();
+    }
+
+    void configureKey(rlottie::ModelCacheKey key) { mKey.store(key); }
+    rlottie::ModelCacheKey key() const { return mKey.load(); }
 
-        if (!mcacheSize) mHash.clear();
+    rlottie::ModelCacheStats stats()
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        auto stats = mStats;
+        stats.entries = mEntries.size();
+        stats.bytes = mBytes;
+        stats.capacity = mcacheSize;
+        stats.budget = mBudget;
+        return stats;
     }
 
 private:
     ModelCache() = default;
 
-    std::unordered_map<std::string, std::shared_ptr<model::Composition>> mHash;
-    std::mutex                                                           mMutex;
+    struct Entry {
+        std::string                         key;
+        std::shared_ptr<model::Composition> value;
+        size_t                              bytes;
+    };
+
+    bool enabled() const { return mcacheSize && mBudget; }
+
+    void trim()
+    {
+        while (!mEntries.empty() &&
+               (mEntries.size() > mcacheSize || mBytes > mBudget)) {
+            mBytes -= mEntries.back().bytes;
+            mHash.erase(mEntries.back().key);
+            mEntries.pop_back();
+            mStats.evictions++;
+        }
+    }
+
+    std::list<Entry>                                             mEntries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> mHash;
+    std::mutex                                                   mMutex;
+    rlottie::ModelCacheStats                                     mStats;
+    std::atomic<rlottie::ModelCacheKey> mKey{rlottie::ModelCacheKey::Caller};
     size_t mcacheSize{10};
+    size_t mBudget{std::numeric_limits<size_t>::max()};
+    size_t mBytes{0};
 };
 
 #else
@@ -94,18 +179,207 @@ public:
     }
     void add(const std::string &, std::shared_ptr<model::Composition>) {}
     void configureCacheSize(size_t) {}
+    void configureBudget(size_t) {}
+    void configureKey(rlottie::ModelCacheKey) {}
+    rlottie::ModelCacheKey key() const { return rlottie::ModelCacheKey::Caller; }
+    rlottie::ModelCacheStats stats() { return {}; }
 };
 
 #endif
 
+/*
+ * A private mapping of the file, written pages are copied on write so the
+ * in-situ parser can alter them without touching the file. Falls back to
+ * reading the file when it can't be mapped.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path)
+    {
+        map(path);
+        if (mOpen) return;
+
+        std::ifstream f(path, std::ios::binary);
+        if (!f.is_open()) return;
+
+        mOpen = true;
+        mBuffer.assign(std::istreambuf_iterator<char>(f),
+                       std::istreambuf_iterator<char>());
+        mData = &mBuffer[0];
+        mSize = mBuffer.size();
+    }
+    ~MappedFile() { unmap(); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool   isOpen() const { return mOpen; }
+    char * data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+#ifdef _WIN32
+    void map(const std::string &path)
+    {
+        int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+        if (len <= 0) return;
+        std::wstring wpath(size_t(len), L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], len);
+
+        HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                                  nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size)) {
+            if (!size.QuadPart) {
+                mOpen = true;
+            } else if (HANDLE mapping = CreateFileMappingW(
+                           file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr)) {
+                mMapped = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+                CloseHandle(mapping);
+                if (mMapped) {
+                    mOpen = true;
+                    mData = static_cast<char *>(mMapped);
+                    mSize = size_t(size.QuadPart);
+                }
+            }
+        }
+        CloseHandle(file);
+    }
+    void unmap()
+    {
+        if (mMapped) UnmapViewOfFile(mMapped);
+    }
+#else
+    void map(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *mapped = mmap(nullptr, size_t(st.st_size),
+                                PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                mOpen = true;
+                mMapped = mapped;
+                mData = static_cast<char *>(mapped);
+                mSize = size_t(st.st_size);
+            }
+        }
+        close(fd);
+    }
+    void unmap()
+    {
+        if (mMapped) munmap(mMapped, mSize);
+    }
+#endif  // _WIN32
+
+    bool        mOpen{false};
+    void *      mMapped{nullptr};
+    char *      mData{nullptr};
+    size_t      mSize{0};
+    std::string mBuffer;
+};
+
+// the directory with its trailing separator, empty for a bare file name.
 static std::string dirname(const std::string &path)
 {
-    const char *ptr = strrchr(path.c_str(), '/');
 #ifdef _WIN32
-    if (ptr) ptr = strrchr(ptr + 1, '\\');
+    // Windows takes either separator, paths from Godot only use '/'.
+    auto pos = path.find_last_of("/\\");
+#else
+    auto pos = path.rfind('/');
 #endif
-    int len = int(ptr + 1 - path.c_str());  // +1 to include '/'
-    return std::string(path, 0, len);
+    if (pos == std::string::npos) return std::string();
+    return std::string(path, 0, pos + 1);
+}
+
+/*
+ * XXH64 of the data, read in host byte order as the result only has to
+ * match within the process.
+ */
+static uint64_t contentHash(const char *data, size_t size)
+{
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t prime3 = 0x165667B19E3779F9ULL;
+    const uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto round = [&](uint64_t acc, uint64_t input) {
+        return rotl(acc + input * prime2, 31) * prime1;
+    };
+    auto merge = [&](uint64_t acc, uint64_t val) {
+        return (acc ^ round(0, val)) * prime1 + prime4;
+    };
+    auto read64 = [](const char *p) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    };
+    auto read32 = [](const char *p) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return uint64_t(v);
+    };
+
+    const char *p = data;
+    const char *end = data + size;
+    uint64_t    h;
+
+    if (size >= 32) {
+        uint64_t v1 = prime1 + prime2;
+        uint64_t v2 = prime2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - prime1;
+        for (; end - p >= 32; p += 32) {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(h, v1);
+        h = merge(h, v2);
+        h = merge(h, v3);
+        h = merge(h, v4);
+    } else {
+        h = prime5;
+    }
+
+    h += size;
+    for (; end - p >= 8; p += 8)
+        h = rotl(h ^ round(0, read64(p)), 27) * prime1 + prime4;
+    if (end - p >= 4) {
+        h = rotl(h ^ (read32(p) * prime1), 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p != end; ++p)
+        h = rotl(h ^ (uint64_t(uchar(*p)) * prime5), 11) * prime1;
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+/*
+ * External images are looked up relative to the resource path, so the same
+ * data loaded from another place may resolve to other images. The leading
+ * '\0' keeps the key apart from the keys callers pass.
+ */
+static std::string contentKey(const char *data, size_t size,
+                              const std::string &resourcePath)
+{
+    char hash[24];
+    snprintf(hash, sizeof(hash), "%016llx",
+             (unsigned long long)contentHash(data, size));
+    return std::string(1, '\0') + hash + resourcePath;
 }
 
 void model::configureModelCacheSize(size_t cacheSize)
@@ -113,50 +387,90 @@ void model::configureModelCacheSize(size_t cacheSize)
     ModelCache::instance().configureCacheSize(cacheSize);
 }
 
+void model::configureModelCacheBudget(size_t budget)
+{
+    ModelCache::instance().configureBudget(budget);
+}
+
+void model::configureModelCacheKey(rlottie::ModelCacheKey key)
+{
+    ModelCache::instance().configureKey(key);
+}
+
+rlottie::ModelCacheStats model::modelCacheStats()
+{
+    return ModelCache::instance().stats();
+}
+
 std::shared_ptr<model::Composition> model::loadFromFile(const std::string &path,
                                                         bool cachePolicy)
 {
-    if (cachePolicy) {
+    bool byContent = ModelCache::instance().key() == ModelCacheKey::Content;
+
+    if (cachePolicy && !byContent) {
         auto obj = ModelCache::instance().find(path);
         if (obj) return obj;
     }
 
-    std::ifstream f;
-    f.open(path);
+    MappedFile file(path);
 
-    if (!f.is_open()) {
+    if (!file.isOpen()) {
         vCritical << "failed to open file = " << path.c_str();
         return {};
-    } else {
-        std::string content;
+    }
 
-        std::getline(f, content, '\0');
-        f.close();
+    if (!file.size()) return {};
 
-        if (content.empty()) return {};
+    std::string key = path;
+    if (cachePolicy && byContent) {
+        key = contentKey(file.data(), file.size(), dirname(path));
+        auto obj = ModelCache::instance().find(key);
+        if (obj) return obj;
+    }
 
-        auto obj = internal::model::parse(const_cast<char *>(content.c_str()),
-                                          dirname(path));
+    std::shared_ptr<model::Composition> obj;
+    if (model::isSerialized(file.data(), file.size()))
+        obj = model::deserialize(file.data(), file.size());
+    else
+        obj = internal::model::parse(file.data(), file.size(), dirname(path));
 
-        if (obj && cachePolicy) ModelCache::instance().add(path, obj);
+    if (obj && cachePolicy) ModelCache::instance().add(key, obj);
 
-        return obj;
-    }
+    return obj;
 }
 
 std::shared_ptr<model::Composition> model::loadFromData(
     std::string jsonData, const std::string &key, std::string resourcePath,
     bool cachePolicy)
 {
+    return loadFromData(&jsonData[0], jsonData.size(), key,
+                        std::move(resourcePath), cachePolicy);
+}
+
+std::shared_ptr<model::Composition> model::loadFromData(
+    char *data, size_t size, const std::string &key, std::string resourcePath,
+    bool cachePolicy)
+{
+    // hashed before the in-situ parse alters the data.
+    std::string cacheKey;
     if (cachePolicy) {
-        auto obj = ModelCache::instance().find(key);
+        if (key.empty() ||
+            ModelCache::instance().key() == ModelCacheKey::Content)
+            cacheKey = contentKey(data, size, resourcePath);
+        else
+            cacheKey = key;
+
+        auto obj = ModelCache::instance().find(cacheKey);
         if (obj) return obj;
     }
 
-    auto obj = internal::model::parse(const_cast<char *>(jsonData.c_str()),
-                                      std::move(resourcePath));
+    std::shared_ptr<model::Composition> obj;
+    if (model::isSerialized(data, size))
+        obj = model::deserialize(data, size);
+    else
+        obj = internal::model::parse(data, size, std::move(resourcePath));
 
-    if (obj && cachePolicy) ModelCache::instance().add(key, obj);
+    if (obj && cachePolicy) ModelCache::instance().add(cacheKey, obj);
 
     return obj;
 }
@@ -164,6 +478,6 @@ std::shared_ptr<model::Composition> model::loadFromData(
 std::shared_ptr<model::Composition> model::loadFromData(
     std::string jsonData, std::string resourcePath, model::ColorFilter filter)
 {
-    return internal::model::parse(const_cast<char *>(jsonData.c_str()),
+    return internal::model::parse(&jsonData[0], jsonData.size(),
                                   std::move(resourcePath), std::move(filter));
 }
@@ -24,6 +24,7 @@
 #include <cassert>
 #include <iterator>
 #include <stack>
+#include <unordered_set>
 #include "vimageloader.h"
 #include "vline.h"
 
@@ -146,6 +147,76 @@ public:
     }
 };
 
+/*
+ * Adds up what the model allocated outside of the arena: path points and
+ * the keyframes holding them, and the decoded images. Precomp layers share
+ * the layers of their asset, those are counted once.
+ */
+class LottieFootprintVisitor {
+public:
+    size_t size{0};
+
+    void visit(model::Object *obj)
+    {
+        switch (obj->type()) {
+        case model::Object::Type::Layer: {
+            auto layer = static_cast<model::Layer *>(obj);
+            if (!mVisited.insert(layer).second) break;
+            if (layer->mExtra) {
+                for (const auto &mask : layer->mExtra->mMasks)
+                    add(mask->mShape);
+            }
+            visitChildren(layer);
+            break;
+        }
+        case model::Object::Type::Repeater: {
+            visitChildren(static_cast<model::Repeater *>(obj)->content());
+            break;
+        }
+        case model::Object::Type::Group: {
+            visitChildren(static_cast<model::Group *>(obj));
+            break;
+        }
+        case model::Object::Type::Path: {
+            add(static_cast<model::Path *>(obj)->mShape);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    void visitChildren(model::Group *obj)
+    {
+        for (const auto &child : obj->mChildren) {
+            if (child) visit(child);
+        }
+    }
+    void add(const model::Asset *asset)
+    {
+        const auto &bitmap = asset->mBitmap;
+        if (bitmap.valid()) size += bitmap.stride() * bitmap.height();
+        size += asset->mLayers.capacity() * sizeof(model::Object *);
+    }
+
+private:
+    void add(const model::Property<model::PathData> &prop)
+    {
+        if (prop.isStatic()) {
+            size += prop.value().mPoints.capacity() * sizeof(VPointF);
+            return;
+        }
+        const auto &frames = prop.animation().frames_;
+        size += frames.capacity() * sizeof(frames.front());
+        for (const auto &frame : frames) {
+            size += (frame.value_.start_.mPoints.capacity() +
+                     frame.value_.end_.mPoints.capacity()) *
+                    sizeof(VPointF);
+        }
+    }
+
+    std::unordered_set<model::Layer *> mVisited;
+};
+
 void model::Composition::processRepeaterObjects()
 {
     LottieRepeaterProcesser visitor;
@@ -156,6 +227,11 @@ void model::Composition::updateStats()
 {
     LottieUpdateStatVisitor visitor(&mStats);
     visitor.visit(mRootLayer);
+
+    LottieFootprintVisitor footprint;
+    footprint.visit(mRootLayer);
+    for (const auto &asset : mAssets) footprint.add(asset.second);
+    mFootprint = sizeof(*this) + mArenaAlloc.heapSize() + footprint.size;
 }
 
 VMatrix model::Repeater::Transform::matrix(int frameNo, float multiplier) const
@@ -24,6 +24,7 @@
 #define LOTModel_H
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
 #include <functional>
@@ -43,6 +44,9 @@ V_USE_NAMESPACE
 
 namespace rlottie {
 
+struct ModelCacheStats;
+enum class ModelCacheKey;
+
 namespace internal {
 
 using Marker = std::tuple<std::string, int, int>;
@@ -232,17 +236,18 @@ public:
         Value<T, Tag>  value_;
     };
 
+    KeyFrames() = default;
+    KeyFrames(const KeyFrames &) = delete;
+    KeyFrames &operator=(const KeyFrames &) = delete;
+
     T value(int frameNo) const
     {
         if (frames_.front().start_ >= frameNo)
             return frames_.front().value_.start_;
         if (frames_.back().end_ <= frameNo) return frames_.back().value_.end_;
 
-        for (const auto &keyFrame : frames_) {
-            if (frameNo >= keyFrame.start_ && frameNo < keyFrame.end_)
-                return keyFrame.value(frameNo);
-        }
-        return {};
+        auto keyFrame = frameAt(frameNo);
+        return keyFrame ? keyFrame->value(frameNo) : T{};
     }
 
     float angle(int frameNo) const
@@ -251,11 +256,52 @@ public:
             (frames_.back().end_ <= frameNo))
             return 0;
 
-        for (const auto &frame : frames_) {
-            if (frameNo >= frame.start_ && frameNo < frame.end_)
-                return frame.angle(frameNo);
+        auto frame = frameAt(frameNo);
+        return frame ? frame->angle(frameNo) : 0;
+    }
+
+    /*
+     * Every frame ends where the next one starts, so when the frames are in
+     * time order a single frame covers frameNo. The frame found last is
+     * tried first, then the one after it, which is where playback goes
+     * next, before falling back to a binary search. The models are shared
+     * between threads, the hint is only ever a guess that gets checked.
+     * A few frames are cheaper to scan.
+     */
+    const Frame *frameAt(int frameNo) const
+    {
+        int hint = HintUnordered;
+        if (frames_.size() > 8) {
+            hint = hint_.load(std::memory_order_relaxed);
+            if (hint == HintUnknown) {
+                hint = ordered() ? 0 : HintUnordered;
+                hint_.store(hint, std::memory_order_relaxed);
+            }
         }
-        return 0;
+
+        if (hint == HintUnordered) {
+            for (const auto &frame : frames_) {
+                if (covers(frame, frameNo)) return &frame;
+            }
+            return nullptr;
+        }
+
+        size_t i = size_t(hint);
+        if (i < frames_.size() && covers(frames_[i], frameNo))
+            return &frames_[i];
+
+        if (i + 1 < frames_.size() && covers(frames_[i + 1], frameNo)) {
+            ++i;
+        } else {
+            auto it = std::upper_bound(
+                frames_.begin(), frames_.end(), frameNo,
+                [](int no, const Frame &frame) { return no < frame.start_; });
+            if (it == frames_.begin()) return nullptr;
+            i = size_t(it - frames_.begin()) - 1;
+            if (!covers(frames_[i], frameNo)) return nullptr;
+        }
+        hint_.store(int(i), std::memory_order_relaxed);
+        return &frames_[i];
     }
 
     bool changed(int prevFrame, int curFrame) const
@@ -271,6 +317,26 @@ public:
         for (auto &e : frames_) e.value_.cache();
     }
 
+private:
+    enum { HintUnknown = -1, HintUnordered = -2 };
+
+    static bool covers(const Frame &frame, int frameNo)
+    {
+        return frameNo >= frame.start_ && frameNo < frame.end_;
+    }
+
+    bool ordered() const
+    {
+        for (size_t i = 1; i < frames_.size(); i++) {
+            if (frames_[i].start_ < frames_[i - 1].start_ ||
+                frames_[i].start_ < frames_[i - 1].end_)
+                return false;
+        }
+        return true;
+    }
+
+    mutable std::atomic<int> hint_{HintUnknown};
+
 public:
     std::vector<Frame> frames_;
 };
@@ -340,11 +406,10 @@ public:
             if (vec.back().end_ <= frameNo)
                 return vec.back().value_.end_.toPath(path);
 
-            for (const auto &keyFrame : vec) {
-                if (frameNo >= keyFrame.start_ && frameNo < keyFrame.end_) {
-                    T::lerp(keyFrame.value_.start_, keyFrame.value_.end_,
-                            keyFrame.progress(frameNo), path);
-                }
+            auto keyFrame = animation().frameAt(frameNo);
+            if (keyFrame) {
+                T::lerp(keyFrame->value_.start_, keyFrame->value_.end_,
+                        keyFrame->progress(frameNo), path);
             }
         }
     }
@@ -541,6 +606,8 @@ public:
     VSize  size() const { return mSize; }
     void   processRepeaterObjects();
     void   updateStats();
+    // bytes held by the model, kept up to date by updateStats().
+    size_t footprint() const { return mFootprint; }
 
 public:
     struct Stats {
@@ -564,6 +631,7 @@ public:
     std::vector<Marker> mMarkers;
     VArenaAlloc         mArenaAlloc{2048};
     Stats               mStats;
+    size_t              mFootprint{0};
 };
 
 class Transform : public Object {
@@ -606,6 +674,12 @@ public:
             impl.mData = data;
         }
     }
+    void set(VMatrix matrix, float opacity)
+    {
+        setStatic(true);
+        new (&impl.mStaticData) StaticData(std::move(matrix), opacity);
+    }
+    const Data *data() const { return isStatic() ? nullptr : impl.mData; }
     VMatrix matrix(int frameNo, bool autoOrient = false) const
     {
         if (isStatic()) return impl.mStaticData.mMatrix;
@@ -1097,6 +1171,12 @@ using ColorFilter = std::function<void(float &, float &, float &)>;
 
 void configureModelCacheSize(size_t cacheSize);
 
+void configureModelCacheBudget(size_t budget);
+
+void configureModelCacheKey(ModelCacheKey key);
+
+ModelCacheStats modelCacheStats();
+
 std::shared_ptr<model::Composition> loadFromFile(const std::string &filePath,
                                                  bool cachePolicy);
 
@@ -1105,13 +1185,27 @@ std::shared_ptr<model::Composition> loadFromData(std::string        jsonData,
                                                  std::string resourcePath,
                                                  bool        cachePolicy);
 
+std::shared_ptr<model::Composition> loadFromData(char *data, size_t size,
+                                                 const std::string &key,
+                                                 std::string resourcePath,
+                                                 bool        cachePolicy);
+
 std::shared_ptr<model::Composition> loadFromData(std::string jsonData,
                                                  std::string resourcePath,
                                                  ColorFilter filter);
 
-std::shared_ptr<model::Composition> parse(char *str, std::string dir_path,
+std::shared_ptr<model::Composition> parse(char *str, size_t size,
+                                          std::string dir_path,
                                           ColorFilter filter = {});
 
+// rlottie's binary model format, see lottieserializer.cpp.
+bool isSerialized(const char *data, size_t size);
+
+std::string serialize(const Composition &composition);
+
+std::shared_ptr<model::Composition> deserialize(const char *data,
+                                                size_t      size);
+
 }  // namespace model
 
 }  // namespace internal
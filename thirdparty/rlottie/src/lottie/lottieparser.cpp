@@ -51,7 +51,7 @@
 // returned null), you should not call SkipArray().
 //
 // This parser uses in-situ strings, so the JSON buffer will be altered during
-// the parse.
+// the parse. The buffer is read up to its size, it needs no terminating '\0'.
 
 #include <array>
 
@@ -67,6 +67,38 @@ using namespace rapidjson;
 
 using namespace rlottie::internal;
 
+// InsituStringStream that ends at the end of the buffer instead of at a '\0',
+// so a mapped file can be parsed where it lies.
+struct BoundedInsituStringStream {
+    typedef char Ch;
+
+    BoundedInsituStringStream(Ch *src, size_t size)
+        : src_(src), end_(src + size), dst_(nullptr), head_(src)
+    {
+    }
+
+    Ch     Peek() const { return src_ != end_ ? *src_ : '\0'; }
+    Ch     Take() { return src_ != end_ ? *src_++ : '\0'; }
+    size_t Tell() const { return static_cast<size_t>(src_ - head_); }
+
+    void   Put(Ch c) { *dst_++ = c; }
+    Ch *   PutBegin() { return dst_ = src_; }
+    size_t PutEnd(Ch *begin) { return static_cast<size_t>(dst_ - begin); }
+    void   Flush() {}
+
+    Ch *src_;
+    Ch *end_;
+    Ch *dst_;
+    Ch *head_;
+};
+
+RAPIDJSON_NAMESPACE_BEGIN
+template <>
+struct StreamTraits<BoundedInsituStringStream> {
+    enum { copyOptimization = 1 };
+};
+RAPIDJSON_NAMESPACE_END
+
 class LookaheadParserHandler {
 public:
     bool Null()
@@ -146,7 +178,7 @@ public:
     }
 
 protected:
-    explicit LookaheadParserHandler(char *str);
+    LookaheadParserHandler(char *str, size_t size);
 
 protected:
     enum LookaheadParsingState {
@@ -166,15 +198,16 @@ protected:
     Value                 v_;
     LookaheadParsingState st_;
     Reader                r_;
-    InsituStringStream    ss_;
+    BoundedInsituStringStream ss_;
 
     static const int parseFlags = kParseDefaultFlags | kParseInsituFlag;
 };
 
 class LottieParserImpl : public LookaheadParserHandler {
 public:
-    LottieParserImpl(char *str, std::string dir_path, model::ColorFilter filter)
-        : LookaheadParserHandler(str),
+    LottieParserImpl(char *str, size_t size, std::string dir_path,
+                     model::ColorFilter filter)
+        : LookaheadParserHandler(str, size),
           mColorFilter(std::move(filter)),
           mDirPath(std::move(dir_path))
     {
@@ -364,8 +397,8 @@ protected:
     void                                             SkipOut(int depth);
 };
 
-LookaheadParserHandler::LookaheadParserHandler(char *str)
-    : v_(), st_(kInit), ss_(str)
+LookaheadParserHandler::LookaheadParserHandler(char *str, size_t size)
+    : v_(), st_(kInit), ss_(str, size)
 {
     r_.IterativeParseInit();
 }
@@ -2353,11 +2386,11 @@ public:
 
 #endif
 
-std::shared_ptr<model::Composition> model::parse(char *             str,
+std::shared_ptr<model::Composition> model::parse(char *str, size_t size,
                                                  std::string        dir_path,
                                                  model::ColorFilter filter)
 {
-    LottieParserImpl obj(str, std::move(dir_path), std::move(filter));
+    LottieParserImpl obj(str, size, std::move(dir_path), std::move(filter));
 
     if (obj.VerifyType()) {
         obj.parseComposition();
@@ -0,0 +1,960 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+
+#include "lottiemodel.h"
+#include "vdebug.h"
+
+using namespace rlottie::internal;
+
+/*
+ * Binary model format.
+ * The parsed composition is written field by field in native byte order,
+ * after the repeaters were processed. The objects are written depth first
+ * with their type in front. Layers of a precomp asset are only written
+ * with the asset, the precomp and image layers find their asset by id again
+ * on load. Interpolators are shared, the first use writes the curve and
+ * later ones its index. Image assets are stored decoded.
+ * The header carries a version and a byte order mark, data from another
+ * version or machine is rejected and has to be parsed from JSON again.
+ */
+
+static constexpr char     serialMagic[4] = {'R', 'L', 'T', 'B'};
+static constexpr uint32_t serialVersion = 1;
+static constexpr uint32_t serialByteOrder = 0x01020304;
+static constexpr uint32_t noIndex = 0xFFFFFFFF;
+
+namespace {
+
+class ModelWriter {
+public:
+    std::string write(const model::Composition &comp)
+    {
+        mData.append(serialMagic, sizeof(serialMagic));
+        put(serialVersion);
+        put(serialByteOrder);
+
+        put(comp.isStatic());
+        putString(comp.mVersion);
+        put(comp.mSize.width());
+        put(comp.mSize.height());
+        put(int64_t(comp.mStartFrame));
+        put(int64_t(comp.mEndFrame));
+        put(comp.mFrameRate);
+        put(comp.mBlendMode);
+
+        put(uint32_t(comp.mMarkers.size()));
+        for (const auto &marker : comp.mMarkers) {
+            putString(std::get<0>(marker));
+            put(int32_t(std::get<1>(marker)));
+            put(int32_t(std::get<2>(marker)));
+        }
+
+        // in id order, so a model always gives the same bytes.
+        std::vector<const model::Asset *> assets;
+        for (const auto &asset : comp.mAssets) assets.push_back(asset.second);
+        std::sort(assets.begin(), assets.end(),
+                  [](const model::Asset *a, const model::Asset *b) {
+                      return a->mRefId < b->mRefId;
+                  });
+        put(uint32_t(assets.size()));
+        for (auto asset : assets) writeAsset(*asset);
+
+        writeObject(comp.mRootLayer);
+        return std::move(mData);
+    }
+
+private:
+    template <typename T>
+    void put(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+        mData.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void putString(const std::string &str)
+    {
+        put(uint32_t(str.size()));
+        mData.append(str);
+    }
+
+    void putName(const model::Object &obj)
+    {
+        const char *name = obj.name();
+        putString(name ? name : "");
+    }
+
+    void writeAsset(const model::Asset &asset)
+    {
+        put(asset.mAssetType);
+        put(asset.isStatic());
+        putString(asset.mRefId);
+        put(int32_t(asset.mWidth));
+        put(int32_t(asset.mHeight));
+
+        put(uint32_t(asset.mLayers.size()));
+        for (auto layer : asset.mLayers) writeObject(layer);
+
+        const VBitmap &bitmap = asset.mBitmap;
+        put(bitmap.valid());
+        if (!bitmap.valid()) return;
+        put(uint32_t(bitmap.width()));
+        put(uint32_t(bitmap.height()));
+        put(bitmap.format());
+        size_t rowSize = bitmap.width() * bitmap.depth() / 8;
+        for (size_t y = 0; y < bitmap.height(); y++)
+            mData.append(reinterpret_cast<const char *>(bitmap.data()) +
+                             y * bitmap.stride(),
+                         rowSize);
+    }
+
+    void writeInterpolator(const VInterpolator *interpolator)
+    {
+        if (!interpolator) {
+            put(noIndex);
+            return;
+        }
+        auto search = mInterpolators.find(interpolator);
+        if (search != mInterpolators.end()) {
+            put(search->second);
+            return;
+        }
+        auto index = uint32_t(mInterpolators.size());
+        mInterpolators[interpolator] = index;
+        put(index);
+        put(interpolator->outTangent());
+        put(interpolator->inTangent());
+    }
+
+    void writeValue(float value) { put(value); }
+    void writeValue(const VPointF &value) { put(value); }
+    void writeValue(const model::Color &value) { put(value); }
+    void writeValue(const model::PathData &value)
+    {
+        put(value.mClosed);
+        put(uint32_t(value.mPoints.size()));
+        mData.append(reinterpret_cast<const char *>(value.mPoints.data()),
+                     value.mPoints.size() * sizeof(VPointF));
+    }
+    void writeValue(const model::Gradient::Data &value)
+    {
+        put(uint32_t(value.mGradient.size()));
+        mData.append(reinterpret_cast<const char *>(value.mGradient.data()),
+                     value.mGradient.size() * sizeof(float));
+    }
+
+    template <typename T>
+    void writeKeyValue(const model::Value<T> &value)
+    {
+        writeValue(value.start_);
+        writeValue(value.end_);
+    }
+    // the tangents are stored as cache() left them.
+    void writeKeyValue(const model::Value<VPointF, model::Position> &value)
+    {
+        put(value.start_);
+        put(value.end_);
+        put(value.inTangent_);
+        put(value.outTangent_);
+        put(value.length_);
+        put(value.hasTangent_);
+    }
+
+    template <typename T, typename Tag>
+    void writeProperty(const model::Property<T, Tag> &prop)
+    {
+        put(prop.isStatic());
+        if (prop.isStatic()) {
+            writeValue(prop.value());
+            return;
+        }
+        const auto &frames = prop.animation().frames_;
+        put(uint32_t(frames.size()));
+        for (const auto &frame : frames) {
+            put(frame.start_);
+            put(frame.end_);
+            writeInterpolator(frame.interpolator_);
+            writeKeyValue(frame.value_);
+        }
+    }
+
+    void writeDash(const model::Dash &dash)
+    {
+        put(uint32_t(dash.mData.size()));
+        for (const auto &prop : dash.mData) writeProperty(prop);
+    }
+
+    void writeTransform(const model::Transform *transform)
+    {
+        put(bool(transform));
+        if (!transform) return;
+
+        put(transform->isStatic());
+        if (transform->isStatic()) {
+            VMatrix m = transform->matrix(0);
+            put(transform->opacity(0));
+            for (float v : {m.m_11(), m.m_12(), m.m_13(), m.m_21(), m.m_22(),
+                            m.m_23(), m.m_tx(), m.m_ty(), m.m_33()})
+                put(v);
+            return;
+        }
+
+        auto data = transform->data();
+        writeProperty(data->mRotation);
+        writeProperty(data->mScale);
+        writeProperty(data->mPosition);
+        writeProperty(data->mAnchor);
+        writeProperty(data->mOpacity);
+        put(bool(data->mExtra));
+        if (!data->mExtra) return;
+        writeProperty(data->mExtra->m3DRx);
+        writeProperty(data->mExtra->m3DRy);
+        writeProperty(data->mExtra->m3DRz);
+        writeProperty(data->mExtra->mSeparateX);
+        writeProperty(data->mExtra->mSeparateY);
+        put(data->mExtra->mSeparate);
+        put(data->mExtra->m3DData);
+    }
+
+    void writeChildren(const model::Group *group)
+    {
+        put(uint32_t(group->mChildren.size()));
+        for (auto child : group->mChildren) writeObject(child);
+        writeTransform(group->mTransform);
+    }
+
+    void writeLayer(const model::Layer *layer)
+    {
+        put(layer->mMatteType);
+        put(layer->mLayerType);
+        put(layer->mBlendMode);
+        put(layer->mHasPathOperator);
+        put(layer->mHasMask);
+        put(layer->mHasRepeater);
+        put(layer->mHasGradient);
+        put(layer->mAutoOrient);
+        put(layer->mLayerSize.width());
+        put(layer->mLayerSize.height());
+        put(int32_t(layer->mParentId));
+        put(int32_t(layer->mId));
+        put(layer->mTimeStreatch);
+        put(int32_t(layer->mInFrame));
+        put(int32_t(layer->mOutFrame));
+        put(int32_t(layer->mStartFrame));
+
+        auto extra = layer->mExtra.get();
+        // children taken from the asset are linked again on load.
+        bool shared = extra && extra->mCompRef &&
+                      layer->mLayerType == model::Layer::Type::Precomp &&
+                      !layer->mChildren.empty() &&
+                      sharesAssetLayers(layer);
+        put(shared);
+        if (shared) {
+            writeTransform(layer->mTransform);
+        } else {
+            writeChildren(layer);
+        }
+
+        put(bool(extra));
+        if (!extra) return;
+        put(extra->mSolidColor);
+        putString(extra->mPreCompRefId);
+        writeProperty(extra->mTimeRemap);
+        put(bool(extra->mAsset));
+        put(uint32_t(extra->mMasks.size()));
+        for (auto mask : extra->mMasks) {
+            writeProperty(mask->mShape);
+            writeProperty(mask->mOpacity);
+            put(mask->mInv);
+            put(mask->mIsStatic);
+            put(mask->mMode);
+        }
+    }
+
+    bool sharesAssetLayers(const model::Layer *layer) const
+    {
+        auto &assets = layer->mExtra->mCompRef->mAssets;
+        auto  search = assets.find(layer->mExtra->mPreCompRefId);
+        return search != assets.end() &&
+               search->second->mLayers == layer->mChildren;
+    }
+
+    void writeGradient(const model::Gradient *obj)
+    {
+        put(int32_t(obj->mGradientType));
+        writeProperty(obj->mStartPoint);
+        writeProperty(obj->mEndPoint);
+        writeProperty(obj->mHighlightLength);
+        writeProperty(obj->mHighlightAngle);
+        writeProperty(obj->mOpacity);
+        writeProperty(obj->mGradient);
+        put(int32_t(obj->mColorPoints));
+        put(obj->mEnabled);
+    }
+
+    void writeObject(const model::Object *obj)
+    {
+        put(obj->type());
+        put(obj->isStatic());
+        put(obj->hidden());
+        putName(*obj);
+
+        switch (obj->type()) {
+        case model::Object::Type::Layer:
+            writeLayer(static_cast<const model::Layer *>(obj));
+            break;
+        case model::Object::Type::Group:
+            writeChildren(static_cast<const model::Group *>(obj));
+            break;
+        case model::Object::Type::Fill: {
+            auto fill = static_cast<const model::Fill *>(obj);
+            put(fill->mFillRule);
+            put(fill->mEnabled);
+            writeProperty(fill->mColor);
+            writeProperty(fill->mOpacity);
+            break;
+        }
+        case model::Object::Type::Stroke: {
+            auto stroke = static_cast<const model::Stroke *>(obj);
+            writeProperty(stroke->mColor);
+            writeProperty(stroke->mOpacity);
+            writeProperty(stroke->mWidth);
+            put(stroke->mCapStyle);
+            put(stroke->mJoinStyle);
+            put(stroke->mMiterLimit);
+            writeDash(stroke->mDash);
+            put(stroke->mEnabled);
+            break;
+        }
+        case model::Object::Type::GFill: {
+            auto fill = static_cast<const model::GradientFill *>(obj);
+            writeGradient(fill);
+            put(fill->mFillRule);
+            break;
+        }
+        case model::Object::Type::GStroke: {
+            auto stroke = static_cast<const model::GradientStroke *>(obj);
+            writeGradient(stroke);
+            writeProperty(stroke->mWidth);
+            put(stroke->mCapStyle);
+            put(stroke->mJoinStyle);
+            put(stroke->mMiterLimit);
+            writeDash(stroke->mDash);
+            break;
+        }
+        case model::Object::Type::Rect: {
+            auto rect = static_cast<const model::Rect *>(obj);
+            put(int32_t(rect->mDirection));
+            writeProperty(rect->mPos);
+            writeProperty(rect->mSize);
+            writeProperty(rect->mRound);
+            break;
+        }
+        case model::Object::Type::Ellipse: {
+            auto ellipse = static_cast<const model::Ellipse *>(obj);
+            put(int32_t(ellipse->mDirection));
+            writeProperty(ellipse->mPos);
+            writeProperty(ellipse->mSize);
+            break;
+        }
+        case model::Object::Type::Path: {
+            auto path = static_cast<const model::Path *>(obj);
+            put(int32_t(path->mDirection));
+            writeProperty(path->mShape);
+            break;
+        }
+        case model::Object::Type::Polystar: {
+            auto star = static_cast<const model::Polystar *>(obj);
+            put(int32_t(star->mDirection));
+            put(star->mPolyType);
+            writeProperty(star->mPos);
+            writeProperty(star->mPointCount);
+            writeProperty(star->mInnerRadius);
+            writeProperty(star->mOuterRadius);
+            writeProperty(star->mInnerRoundness);
+            writeProperty(star->mOuterRoundness);
+            writeProperty(star->mRotation);
+            break;
+        }
+        case model::Object::Type::Trim: {
+            auto trim = static_cast<const model::Trim *>(obj);
+            writeProperty(trim->mStart);
+            writeProperty(trim->mEnd);
+            writeProperty(trim->mOffset);
+            put(trim->mTrimType);
+            break;
+        }
+        case model::Object::Type::Repeater: {
+            auto repeater = static_cast<const model::Repeater *>(obj);
+            writeObject(repeater->mContent);
+            writeProperty(repeater->mTransform.mRotation);
+            writeProperty(repeater->mTransform.mScale);
+            writeProperty(repeater->mTransform.mPosition);
+            writeProperty(repeater->mTransform.mAnchor);
+            writeProperty(repeater->mTransform.mStartOpacity);
+            writeProperty(repeater->mTransform.mEndOpacity);
+            writeProperty(repeater->mCopies);
+            writeProperty(repeater->mOffset);
+            put(repeater->mMaxCopies);
+            put(repeater->mProcessed);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    std::string                                         mData;
+    std::unordered_map<const VInterpolator *, uint32_t> mInterpolators;
+};
+
+class ModelReader {
+public:
+    ModelReader(const char *data, size_t size) : mPos(data), mEnd(data + size)
+    {
+    }
+
+    std::shared_ptr<model::Composition> read()
+    {
+        char magic[sizeof(serialMagic)];
+        if (!take(magic, sizeof(magic)) ||
+            memcmp(magic, serialMagic, sizeof(magic)) ||
+            get<uint32_t>() != serialVersion ||
+            get<uint32_t>() != serialByteOrder)
+            return nullptr;
+
+        auto comp = std::make_shared<model::Composition>();
+        mComp = comp.get();
+
+        mComp->setStatic(getBool());
+        mComp->mVersion = getString();
+        mComp->mSize.setWidth(get<int>());
+        mComp->mSize.setHeight(get<int>());
+        mComp->mStartFrame = long(get<int64_t>());
+        mComp->mEndFrame = long(get<int64_t>());
+        mComp->mFrameRate = get<float>();
+        mComp->mBlendMode =
+            getEnum(model::BlendMode::Normal, model::BlendMode::OverLay);
+
+        auto markers = getCount(12);
+        for (uint32_t i = 0; i < markers; i++) {
+            auto comment = getString();
+            auto start = get<int32_t>();
+            auto end = get<int32_t>();
+            mComp->mMarkers.emplace_back(std::move(comment), start, end);
+        }
+
+        auto assets = getCount(16);
+        for (uint32_t i = 0; i < assets && mValid; i++) {
+            auto asset = readAsset();
+            mComp->mAssets[asset->mRefId] = asset;
+        }
+
+        // the root is the only layer without a transform.
+        auto root = readObject();
+        if (!mValid || !root || root->type() != model::Object::Type::Layer)
+            return nullptr;
+        mComp->mRootLayer = static_cast<model::Layer *>(root);
+        if (!mComp->mRootLayer->precompLayer() ||
+            mComp->mRootLayer->mTransform || mUntransformed != 1)
+            return nullptr;
+
+        for (const auto &link : mLinks) {
+            auto search = mComp->mAssets.find(link.first->mExtra->mPreCompRefId);
+            if (search == mComp->mAssets.end()) continue;
+            if (link.second)
+                link.first->mChildren = search->second->mLayers;
+            else
+                link.first->mExtra->mAsset = search->second;
+        }
+
+        mComp->updateStats();
+        return comp;
+    }
+
+private:
+    bool take(void *dst, size_t size)
+    {
+        if (!mValid || size_t(mEnd - mPos) < size) {
+            mValid = false;
+            return false;
+        }
+        memcpy(dst, mPos, size);
+        mPos += size;
+        return true;
+    }
+
+    template <typename T>
+    T get()
+    {
+        T value{};
+        take(&value, sizeof(T));
+        return value;
+    }
+
+    // enums outside [first, last] would reach renderer switches and tables.
+    template <typename T>
+    T getEnum(T first, T last)
+    {
+        using Raw = typename std::underlying_type<T>::type;
+        auto value = get<Raw>();
+        if (value < Raw(first) || value > Raw(last)) {
+            mValid = false;
+            return first;
+        }
+        return T(value);
+    }
+
+    // any byte but 0 reads as true, corrupt data can't make invalid bools.
+    bool getBool() { return get<uint8_t>() != 0; }
+
+    // a count of items at least minSize bytes each, checked against what is
+    // left so corrupt data can't ask for huge allocations.
+    uint32_t getCount(size_t minSize)
+    {
+        auto count = get<uint32_t>();
+        if (count > size_t(mEnd - mPos) / minSize) {
+            mValid = false;
+            return 0;
+        }
+        return count;
+    }
+
+    std::string getString()
+    {
+        auto        size = getCount(1);
+        std::string str(mPos, mValid ? size : 0);
+        mPos += str.size();
+        return str;
+    }
+
+    model::Asset *readAsset()
+    {
+        auto asset = mComp->mArenaAlloc.make<model::Asset>();
+        asset->mAssetType =
+            getEnum(model::Asset::Type::Precomp, model::Asset::Type::Char);
+        asset->setStatic(getBool());
+        asset->mRefId = getString();
+        asset->mWidth = get<int32_t>();
+        asset->mHeight = get<int32_t>();
+
+        auto layers = getCount(4);
+        for (uint32_t i = 0; i < layers && mValid; i++) {
+            auto layer = readObject();
+            if (layer) asset->mLayers.push_back(layer);
+        }
+
+        if (!getBool()) return asset;
+        auto width = get<uint32_t>();
+        auto height = get<uint32_t>();
+        auto format = getEnum(VBitmap::Format::Invalid,
+                              VBitmap::Format::ARGB32_Premultiplied);
+        if (!mValid || !width || !height) return asset;
+        VBitmap bitmap(width, height, format);
+        size_t  rowSize = bitmap.width() * bitmap.depth() / 8;
+        if (!bitmap.valid() || rowSize * height > size_t(mEnd - mPos)) {
+            mValid = false;
+            return asset;
+        }
+        for (size_t y = 0; y < height; y++)
+            take(bitmap.data() + y * bitmap.stride(), rowSize);
+        asset->mBitmap = bitmap;
+        return asset;
+    }
+
+    VInterpolator *readInterpolator()
+    {
+        auto index = get<uint32_t>();
+        if (index == noIndex) return nullptr;
+        if (index < mInterpolators.size()) return mInterpolators[index];
+        if (index != mInterpolators.size()) {
+            mValid = false;
+            return nullptr;
+        }
+        auto outTangent = get<VPointF>();
+        auto inTangent = get<VPointF>();
+        auto interpolator =
+            mComp->mArenaAlloc.make<VInterpolator>(outTangent, inTangent);
+        mInterpolators.push_back(interpolator);
+        return interpolator;
+    }
+
+    void readValue(float &value) { value = get<float>(); }
+    void readValue(VPointF &value) { value = get<VPointF>(); }
+    void readValue(model::Color &value) { value = get<model::Color>(); }
+    void readValue(model::PathData &value)
+    {
+        value.mClosed = getBool();
+        value.mPoints.resize(getCount(sizeof(VPointF)));
+        take(value.mPoints.data(), value.mPoints.size() * sizeof(VPointF));
+        // a move and whole cubics, or no shape at all like the parser gives.
+        if (!value.mPoints.empty() && value.mPoints.size() % 3 != 1)
+            mValid = false;
+    }
+    void readValue(model::Gradient::Data &value)
+    {
+        value.mGradient.resize(getCount(sizeof(float)));
+        take(value.mGradient.data(), value.mGradient.size() * sizeof(float));
+    }
+
+    template <typename T>
+    void readKeyValue(model::Value<T> &value)
+    {
+        readValue(value.start_);
+        readValue(value.end_);
+    }
+    void readKeyValue(model::Value<VPointF, model::Position> &value)
+    {
+        value.start_ = get<VPointF>();
+        value.end_ = get<VPointF>();
+        value.inTangent_ = get<VPointF>();
+        value.outTangent_ = get<VPointF>();
+        value.length_ = get<float>();
+        value.hasTangent_ = getBool();
+    }
+
+    template <typename T, typename Tag>
+    void readProperty(model::Property<T, Tag> &prop)
+    {
+        if (getBool()) {
+            readValue(prop.value());
+            return;
+        }
+        auto  count = getCount(12);
+        auto &frames = prop.animation().frames_;
+        frames.resize(count);
+        for (auto &frame : frames) {
+            frame.start_ = get<float>();
+            frame.end_ = get<float>();
+            frame.interpolator_ = readInterpolator();
+            readKeyValue(frame.value_);
+        }
+        // the keyframe lookups expect at least one frame.
+        if (frames.empty()) mValid = false;
+    }
+
+    void readDash(model::Dash &dash)
+    {
+        auto count = getCount(1);
+        for (uint32_t i = 0; i < count && mValid; i++) {
+            dash.mData.emplace_back();
+            readProperty(dash.mData.back());
+        }
+    }
+
+    model::Transform *readTransform()
+    {
+        if (!getBool()) return nullptr;
+
+        auto transform = mComp->mArenaAlloc.make<model::Transform>();
+        if (getBool()) {
+            float opacity = get<float>();
+            float m[9];
+            for (auto &v : m) v = get<float>();
+            transform->set(
+                VMatrix(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]),
+                opacity);
+            return transform;
+        }
+
+        auto data = mComp->mArenaAlloc.make<model::Transform::Data>();
+        readProperty(data->mRotation);
+        readProperty(data->mScale);
+        readProperty(data->mPosition);
+        readProperty(data->mAnchor);
+        readProperty(data->mOpacity);
+        if (getBool()) {
+            data->createExtraData();
+            readProperty(data->mExtra->m3DRx);
+            readProperty(data->mExtra->m3DRy);
+            readProperty(data->mExtra->m3DRz);
+            readProperty(data->mExtra->mSeparateX);
+            readProperty(data->mExtra->mSeparateY);
+            data->mExtra->mSeparate = getBool();
+            data->mExtra->m3DData = getBool();
+        }
+        transform->set(data, false);
+        return transform;
+    }
+
+    void readChildren(model::Group *group)
+    {
+        auto count = getCount(4);
+        for (uint32_t i = 0; i < count && mValid; i++) {
+            auto child = readObject();
+            if (child) group->mChildren.push_back(child);
+        }
+        group->mTransform = readTransform();
+    }
+
+    void readLayer(model::Layer *layer)
+    {
+        layer->mMatteType = getEnum(model::MatteType::None,
+                                       model::MatteType::LumaInv);
+        layer->mLayerType = getEnum(model::Layer::Type::Precomp,
+                                      model::Layer::Type::Text);
+        layer->mBlendMode =
+            getEnum(model::BlendMode::Normal, model::BlendMode::OverLay);
+        layer->mHasPathOperator = getBool();
+        layer->mHasMask = getBool();
+        layer->mHasRepeater = getBool();
+        layer->mHasGradient = getBool();
+        layer->mAutoOrient = getBool();
+        layer->mLayerSize.setWidth(get<int>());
+        layer->mLayerSize.setHeight(get<int>());
+        layer->mParentId = get<int32_t>();
+        layer->mId = get<int32_t>();
+        layer->mTimeStreatch = get<float>();
+        layer->mInFrame = get<int32_t>();
+        layer->mOutFrame = get<int32_t>();
+        layer->mStartFrame = get<int32_t>();
+
+        bool shared = getBool();
+        if (shared) {
+            layer->mTransform = readTransform();
+        } else {
+            readChildren(layer);
+        }
+        if (!layer->mTransform) mUntransformed++;
+
+        // the renderer expects the extra data of these.
+        if (!getBool()) {
+            if (shared || layer->hasMask() ||
+                layer->mLayerType == model::Layer::Type::Solid)
+                mValid = false;
+            return;
+        }
+        auto extra = layer->extra();
+        extra->mCompRef = mComp;
+        extra->mSolidColor = get<model::Color>();
+        extra->mPreCompRefId = getString();
+        readProperty(extra->mTimeRemap);
+        if (shared) mLinks.emplace_back(layer, true);
+        if (getBool()) mLinks.emplace_back(layer, false);
+        auto masks = getCount(4);
+        for (uint32_t i = 0; i < masks && mValid; i++) {
+            auto mask = mComp->mArenaAlloc.make<model::Mask>();
+            readProperty(mask->mShape);
+            readProperty(mask->mOpacity);
+            mask->mInv = getBool();
+            mask->mIsStatic = getBool();
+            mask->mMode = getEnum(model::Mask::Mode::None,
+                                   model::Mask::Mode::Difference);
+            extra->mMasks.push_back(mask);
+        }
+    }
+
+    void readGradient(model::Gradient *obj)
+    {
+        obj->mGradientType = get<int32_t>();
+        readProperty(obj->mStartPoint);
+        readProperty(obj->mEndPoint);
+        readProperty(obj->mHighlightLength);
+        readProperty(obj->mHighlightAngle);
+        readProperty(obj->mOpacity);
+        readProperty(obj->mGradient);
+        obj->mColorPoints = get<int32_t>();
+        obj->mEnabled = getBool();
+    }
+
+    model::Object *readObject()
+    {
+        // guards against corrupt data nesting without end.
+        if (++mDepth > 1000) mValid = false;
+
+        auto type = get<model::Object::Type>();
+        bool staticFlag = getBool();
+        bool hidden = getBool();
+        auto name = getString();
+        if (!mValid) return nullptr;
+
+        model::Object *obj = nullptr;
+        auto &         alloc = mComp->mArenaAlloc;
+        switch (type) {
+        case model::Object::Type::Layer: {
+            auto layer = alloc.make<model::Layer>();
+            readLayer(layer);
+            obj = layer;
+            break;
+        }
+        case model::Object::Type::Group: {
+            auto group = alloc.make<model::Group>();
+            readChildren(group);
+            obj = group;
+            break;
+        }
+        case model::Object::Type::Fill: {
+            auto fill = alloc.make<model::Fill>();
+            fill->mFillRule = getEnum(FillRule::EvenOdd, FillRule::Winding);
+            fill->mEnabled = getBool();
+            readProperty(fill->mColor);
+            readProperty(fill->mOpacity);
+            obj = fill;
+            break;
+        }
+        case model::Object::Type::Stroke: {
+            auto stroke = alloc.make<model::Stroke>();
+            readProperty(stroke->mColor);
+            readProperty(stroke->mOpacity);
+            readProperty(stroke->mWidth);
+            stroke->mCapStyle = getEnum(CapStyle::Flat, CapStyle::Round);
+            stroke->mJoinStyle = getEnum(JoinStyle::Miter, JoinStyle::Round);
+            stroke->mMiterLimit = get<float>();
+            readDash(stroke->mDash);
+            stroke->mEnabled = getBool();
+            obj = stroke;
+            break;
+        }
+        case model::Object::Type::GFill: {
+            auto fill = alloc.make<model::GradientFill>();
+            readGradient(fill);
+            fill->mFillRule = getEnum(FillRule::EvenOdd, FillRule::Winding);
+            obj = fill;
+            break;
+        }
+        case model::Object::Type::GStroke: {
+            auto stroke = alloc.make<model::GradientStroke>();
+            readGradient(stroke);
+            readProperty(stroke->mWidth);
+            stroke->mCapStyle = getEnum(CapStyle::Flat, CapStyle::Round);
+            stroke->mJoinStyle = getEnum(JoinStyle::Miter, JoinStyle::Round);
+            stroke->mMiterLimit = get<float>();
+            readDash(stroke->mDash);
+            obj = stroke;
+            break;
+        }
+        case model::Object::Type::Rect: {
+            auto rect = alloc.make<model::Rect>();
+            rect->mDirection = get<int32_t>();
+            readProperty(rect->mPos);
+            readProperty(rect->mSize);
+            readProperty(rect->mRound);
+            obj = rect;
+            break;
+        }
+        case model::Object::Type::Ellipse: {
+            auto ellipse = alloc.make<model::Ellipse>();
+            ellipse->mDirection = get<int32_t>();
+            readProperty(ellipse->mPos);
+            readProperty(ellipse->mSize);
+            obj = ellipse;
+            break;
+        }
+        case model::Object::Type::Path: {
+            auto path = alloc.make<model::Path>();
+            path->mDirection = get<int32_t>();
+            readProperty(path->mShape);
+            obj = path;
+            break;
+        }
+        case model::Object::Type::Polystar: {
+            auto star = alloc.make<model::Polystar>();
+            star->mDirection = get<int32_t>();
+            star->mPolyType = getEnum(model::Polystar::PolyType::Star,
+                                     model::Polystar::PolyType::Polygon);
+            readProperty(star->mPos);
+            readProperty(star->mPointCount);
+            readProperty(star->mInnerRadius);
+            readProperty(star->mOuterRadius);
+            readProperty(star->mInnerRoundness);
+            readProperty(star->mOuterRoundness);
+            readProperty(star->mRotation);
+            obj = star;
+            break;
+        }
+        case model::Object::Type::Trim: {
+            auto trim = alloc.make<model::Trim>();
+            readProperty(trim->mStart);
+            readProperty(trim->mEnd);
+            readProperty(trim->mOffset);
+            trim->mTrimType = getEnum(model::Trim::TrimType::Simultaneously,
+                                     model::Trim::TrimType::Individually);
+            obj = trim;
+            break;
+        }
+        case model::Object::Type::Repeater: {
+            auto repeater = alloc.make<model::Repeater>();
+            auto content = readObject();
+            if (!content || content->type() != model::Object::Type::Group) {
+                mValid = false;
+                return nullptr;
+            }
+            repeater->setContent(static_cast<model::Group *>(content));
+            readProperty(repeater->mTransform.mRotation);
+            readProperty(repeater->mTransform.mScale);
+            readProperty(repeater->mTransform.mPosition);
+            readProperty(repeater->mTransform.mAnchor);
+            readProperty(repeater->mTransform.mStartOpacity);
+            readProperty(repeater->mTransform.mEndOpacity);
+            readProperty(repeater->mCopies);
+            readProperty(repeater->mOffset);
+            repeater->mMaxCopies = get<float>();
+            if (getBool()) repeater->markProcessed();
+            obj = repeater;
+            break;
+        }
+        default:
+            mValid = false;
+            return nullptr;
+        }
+
+        obj->setStatic(staticFlag);
+        obj->setHidden(hidden);
+        if (!name.empty()) obj->setName(name.c_str());
+        --mDepth;
+        return obj;
+    }
+
+    const char *                                  mPos;
+    const char *                                  mEnd;
+    bool                                          mValid{true};
+    int                                           mDepth{0};
+    size_t                                        mUntransformed{0};
+    model::Composition *                          mComp{nullptr};
+    std::vector<VInterpolator *>                  mInterpolators;
+    std::vector<std::pair<model::Layer *, bool>>  mLinks;
+};
+
+}  // namespace
+
+bool model::isSerialized(const char *data, size_t size)
+{
+    return size >= sizeof(serialMagic) &&
+           !memcmp(data, serialMagic, sizeof(serialMagic));
+}
+
+std::string model::serialize(const model::Composition &composition)
+{
+    return ModelWriter().write(composition);
+}
+
+std::shared_ptr<model::Composition> model::deserialize(const char *data,
+                                                       size_t      size)
+{
+    auto composition = ModelReader(data, size).read();
+    if (!composition) vWarning << "Input data is not a valid rlottie model!";
+    return composition;
+}
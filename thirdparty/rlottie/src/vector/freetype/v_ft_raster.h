@@ -102,7 +102,7 @@
 /*                                                                       */
 /*                  Bits 3 and~4 are reserved for internal purposes.     */
 /*                                                                       */
-/*    contours   :: An array of `n_contours' shorts, giving the end      */
+/*    contours   :: An array of `n_contours' ints, giving the end        */
 /*                  point of each contour within the outline.  For       */
 /*                  example, the first contour is defined by the points  */
 /*                  `0' to `contours[0]', the second one is defined by   */
@@ -114,12 +114,12 @@
 /*                                                                       */
 typedef struct  SW_FT_Outline_
 {
-  short       n_contours;      /* number of contours in glyph        */
-  short       n_points;        /* number of points in the glyph      */
+  int         n_contours;      /* number of contours in glyph        */
+  int         n_points;        /* number of points in the glyph      */
 
   SW_FT_Vector*  points;          /* the outline's points               */
   char*       tags;            /* the points flags                   */
-  short*      contours;        /* the contour end points             */
+  int*        contours;        /* the contour end points             */
   char*       contours_flag;   /* the contour open flags             */
 
   int         flags;           /* outline masks                      */
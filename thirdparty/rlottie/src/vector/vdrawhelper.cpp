@@ -183,6 +183,22 @@ void VRasterBuffer::clear()
     memset(mBuffer, 0, mHeight * mBytesPerLine);
 }
 
+void VRasterBuffer::clear(const VRect &rect)
+{
+    VRect r = rect & VRect(0, 0, int(mWidth), int(mHeight));
+    if (r.empty()) return;
+
+    if (r.width() == int(mWidth) && r.height() == int(mHeight)) {
+        clear();
+        return;
+    }
+
+    for (int y = r.top(); y < r.bottom(); y++) {
+        memfill32(reinterpret_cast<uint32_t *>(scanLine(y)) + r.left(), 0,
+                  r.width());
+    }
+}
+
 VBitmap::Format VRasterBuffer::prepare(const VBitmap *image)
 {
     mBuffer = image->data();
@@ -754,6 +770,21 @@ void VSpanData::updateSpanFunc()
     }
 }
 
+const uint32_t *vUnpremultiplyTable()
+{
+    struct Table {
+        uint32_t entries[256];
+        Table()
+        {
+            entries[0] = 0;
+            for (uint32_t a = 1; a < 256; a++)
+                entries[a] = ((255u << 16) + a - 1) / a;
+        }
+    };
+    static const Table table;
+    return table.entries;
+}
+
 #if !defined(__SSE2__) && !defined(__ARM_NEON__)
 void memfill32(uint32_t *dest, uint32_t value, int length)
 {
@@ -762,5 +793,26 @@ void memfill32(uint32_t *dest, uint32_t value, int length)
         *dest++ = value;
     }
 }
+
+void memswaprb32(uint32_t *dest, int length)
+{
+    for (int i = 0; i < length; i++) {
+        uint32_t p = dest[i];
+        dest[i] = (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+    }
+}
+
+void memunpremultiply32(uint32_t *dest, int length, bool swapRB)
+{
+    const uint32_t *table = vUnpremultiplyTable();
+    for (int i = 0; i < length; i++) {
+        uint32_t a = vAlpha(dest[i]);
+        if (a == 255) {
+            if (swapRB) memswaprb32(dest + i, 1);
+        } else if (a) {
+            dest[i] = unpremultiply_pixel(dest[i], table, swapRB);
+        }
+    }
+}
 #endif
 
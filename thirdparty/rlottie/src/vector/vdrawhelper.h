@@ -24,6 +24,7 @@
 #define VDRAWHELPER_H
 
 #include <memory>
+#include <algorithm>
 #include <array>
 #include "assert.h"
 #include "vbitmap.h"
@@ -91,6 +92,11 @@ typedef void (*ProcessRleSpan)(size_t count, const VRle::Span *spans,
                                void *userData);
 
 extern void memfill32(uint32_t *dest, uint32_t value, int count);
+// swaps the red and blue channel of count pixels in place (ARGB <-> ABGR).
+extern void memswaprb32(uint32_t *dest, int count);
+// turns count premultiplied pixels into straight alpha in place, optionally
+// swapping the red and blue channel in the same pass.
+extern void memunpremultiply32(uint32_t *dest, int count, bool swapRB);
 
 struct LinearGradientValues {
     float dx;
@@ -124,6 +130,7 @@ class VRasterBuffer {
 public:
     VBitmap::Format prepare(const VBitmap *image);
     void            clear();
+    void            clear(const VRect &rect);
 
     void resetBuffer(int val = 0);
 
@@ -197,17 +204,22 @@ struct VSpanData {
                int alpha = 255);
     void setupMatrix(const VMatrix &matrix);
 
-    VRect clipRect() const
+    VRect drawRect() const
     {
         return VRect(0, 0, mDrawableSize.width(), mDrawableSize.height());
     }
 
+    VRect clipRect() const { return mClip; }
+
     void setDrawRegion(const VRect &region)
     {
         mOffset = VPoint(region.left(), region.top());
         mDrawableSize = VSize(region.width(), region.height());
+        mClip = drawRect();
     }
 
+    void setClipRect(const VRect &rect) { mClip = rect & drawRect(); }
+
     uint *buffer(int x, int y) const
     {
         return mRasterBuffer->pixelRef(x + mOffset.x(), y + mOffset.y());
@@ -223,6 +235,7 @@ struct VSpanData {
     std::shared_ptr<const VColorTable> mColorTable{nullptr};
     VPoint                             mOffset;  // offset to the subsurface
     VSize                              mDrawableSize;  // suburface size
+    VRect                              mClip;  // part of it drawn to
     uint32_t                           mSolid;
     VGradientData                      mGradient;
     VTextureData                       mTexture;
@@ -256,6 +269,26 @@ inline constexpr int vAlpha(uint32_t c)
     return c >> 24;
 }
 
+/*
+ * reciprocal table for un-premultiplying, entry a is ceil(255 * 65536 / a)
+ * so that (c * table[a] + 0x8000) >> 16 is exactly round(c * 255 / a) for
+ * every c <= a, without a division per channel. Channels above their alpha
+ * (blend rounding, straight alpha images) clamp to 255.
+ */
+const uint32_t *vUnpremultiplyTable();
+
+static inline uint32_t unpremultiply_pixel(uint32_t p, const uint32_t *table,
+                                           bool swapRB)
+{
+    uint32_t a = vAlpha(p);
+    uint32_t inv = table[a];
+    uint32_t r = std::min((uint32_t(vRed(p)) * inv + 0x8000) >> 16, 255u);
+    uint32_t g = std::min((uint32_t(vGreen(p)) * inv + 0x8000) >> 16, 255u);
+    uint32_t b = std::min((uint32_t(vBlue(p)) * inv + 0x8000) >> 16, 255u);
+    if (swapRB) std::swap(r, b);
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
 static inline uint32_t interpolate_pixel(uint x, uint a, uint y, uint b)
 {
     uint t = (x & 0xff00ff) * a + (y & 0xff00ff) * b;
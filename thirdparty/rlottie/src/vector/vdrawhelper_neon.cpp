@@ -1,5 +1,6 @@
 #if defined(__ARM_NEON__)
 
+#include <arm_neon.h>
 #include "vdrawhelper.h"
 
 extern "C" void pixman_composite_src_n_8888_asm_neon(int32_t w, int32_t h,
@@ -17,6 +18,63 @@ void memfill32(uint32_t *dest, uint32_t value, int length)
     pixman_composite_src_n_8888_asm_neon(length, 1, dest, length, value);
 }
 
+void memswaprb32(uint32_t *dest, int length)
+{
+    uint8_t *ptr = reinterpret_cast<uint8_t *>(dest);
+    for (; length >= 16; length -= 16, ptr += 64) {
+        uint8x16x4_t v = vld4q_u8(ptr);
+        uint8x16_t   t = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = t;
+        vst4q_u8(ptr, v);
+    }
+    dest = reinterpret_cast<uint32_t *>(ptr);
+    for (int i = 0; i < length; i++) {
+        uint32_t p = dest[i];
+        dest[i] = (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+    }
+}
+
+// (channel * inv + 0x8000) >> 16 for 16 channels widened to 32bit lanes,
+// narrowed back with saturation so channels above their alpha clamp to 255.
+static inline uint8x16_t v16_unpremultiply_channel_neon(uint8x16_t c,
+                                                         const uint32x4_t *inv)
+{
+    uint16x8_t lo = vmovl_u8(vget_low_u8(c));
+    uint16x8_t hi = vmovl_u8(vget_high_u8(c));
+    uint32x4_t p0 = vmulq_u32(vmovl_u16(vget_low_u16(lo)), inv[0]);
+    uint32x4_t p1 = vmulq_u32(vmovl_u16(vget_high_u16(lo)), inv[1]);
+    uint32x4_t p2 = vmulq_u32(vmovl_u16(vget_low_u16(hi)), inv[2]);
+    uint32x4_t p3 = vmulq_u32(vmovl_u16(vget_high_u16(hi)), inv[3]);
+    uint16x8_t r0 = vcombine_u16(vraddhn_u32(p0, vdupq_n_u32(0)),
+                                 vraddhn_u32(p1, vdupq_n_u32(0)));
+    uint16x8_t r1 = vcombine_u16(vraddhn_u32(p2, vdupq_n_u32(0)),
+                                 vraddhn_u32(p3, vdupq_n_u32(0)));
+    return vcombine_u8(vqmovn_u16(r0), vqmovn_u16(r1));
+}
+
+void memunpremultiply32(uint32_t *dest, int length, bool swapRB)
+{
+    const uint32_t *table = vUnpremultiplyTable();
+    uint8_t *       ptr = reinterpret_cast<uint8_t *>(dest);
+    for (; length >= 16; length -= 16, ptr += 64) {
+        uint8x16x4_t v = vld4q_u8(ptr);
+        uint32_t     inv[16];
+        for (int i = 0; i < 16; i++) inv[i] = table[ptr[i * 4 + 3]];
+        const uint32x4_t vinv[4] = {vld1q_u32(inv), vld1q_u32(inv + 4),
+                                    vld1q_u32(inv + 8), vld1q_u32(inv + 12)};
+        uint8x16_t b = v16_unpremultiply_channel_neon(v.val[0], vinv);
+        uint8x16_t r = v16_unpremultiply_channel_neon(v.val[2], vinv);
+        v.val[0] = swapRB ? r : b;
+        v.val[1] = v16_unpremultiply_channel_neon(v.val[1], vinv);
+        v.val[2] = swapRB ? b : r;
+        vst4q_u8(ptr, v);
+    }
+    dest = reinterpret_cast<uint32_t *>(ptr);
+    for (int i = 0; i < length; i++)
+        dest[i] = unpremultiply_pixel(dest[i], table, swapRB);
+}
+
 static void color_SourceOver(uint32_t *dest, int length,
                                       uint32_t color,
                                      uint32_t const_alpha)
@@ -175,6 +175,94 @@ void memfill32(uint32_t* dest, uint32_t value, int length)
     }
 }
 
+void memswaprb32(uint32_t* dest, int length)
+{
+    const __m128i ag_mask = _mm_set1_epi32(0xFF00FF00);
+    const __m128i b_mask = _mm_set1_epi32(0x000000FF);
+    const __m128i r_mask = _mm_set1_epi32(0x00FF0000);
+
+    while (length >= 4) {
+        __m128i v = _mm_loadu_si128((__m128i*)dest);
+        __m128i r = _mm_and_si128(r_mask, _mm_slli_epi32(v, 16));
+        __m128i b = _mm_and_si128(b_mask, _mm_srli_epi32(v, 16));
+        v = _mm_or_si128(_mm_and_si128(ag_mask, v), _mm_or_si128(r, b));
+        _mm_storeu_si128((__m128i*)dest, v);
+
+        dest += 4;
+        length -= 4;
+    }
+
+    while (length) {
+        uint32_t p = *dest;
+        *dest++ = (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+        length--;
+    }
+}
+
+// full 32bit product of each lane (SSE2 only multiplies the even lanes)
+inline static __m128i v4_mul_u32_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// (channel * inv + 0x8000) >> 16 of the channel at bit offset shift,
+// clamped to 255. The result fits 16 bits, so the clamp is an unsigned
+// 16 bit min done with a saturating subtract.
+inline static __m128i v4_unpremultiply_channel_sse2(__m128i v, __m128i inv,
+                                                   int shift)
+{
+    const __m128i byte_mask = _mm_set1_epi32(0xFF);
+    const __m128i round = _mm_set1_epi32(0x8000);
+
+    __m128i c = _mm_and_si128(byte_mask, _mm_srli_epi32(v, shift));
+    c = _mm_add_epi32(v4_mul_u32_sse2(c, inv), round);
+    c = _mm_srli_epi32(c, 16);
+    return _mm_sub_epi16(c, _mm_subs_epu16(c, byte_mask));
+}
+
+void memunpremultiply32(uint32_t* dest, int length, bool swapRB)
+{
+    const uint32_t *table = vUnpremultiplyTable();
+    const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+    const int r_shift = swapRB ? 0 : 16;
+    const int b_shift = swapRB ? 16 : 0;
+
+    while (length >= 4) {
+        __m128i v = _mm_loadu_si128((__m128i*)dest);
+        __m128i a = _mm_and_si128(alpha_mask, v);
+
+        // fully opaque or fully transparent pixels need no division.
+        int opaque = _mm_movemask_epi8(_mm_cmpeq_epi32(a, alpha_mask));
+        int clear = _mm_movemask_epi8(_mm_cmpeq_epi32(a, _mm_setzero_si128()));
+        if ((opaque | clear) == 0xFFFF) {
+            if (swapRB) memswaprb32(dest, 4);
+        } else {
+            __m128i inv = _mm_set_epi32(table[dest[3] >> 24], table[dest[2] >> 24],
+                                        table[dest[1] >> 24], table[dest[0] >> 24]);
+            __m128i r = v4_unpremultiply_channel_sse2(v, inv, 16);
+            __m128i g = v4_unpremultiply_channel_sse2(v, inv, 8);
+            __m128i b = v4_unpremultiply_channel_sse2(v, inv, 0);
+            r = _mm_sll_epi32(r, _mm_cvtsi32_si128(r_shift));
+            g = _mm_slli_epi32(g, 8);
+            b = _mm_sll_epi32(b, _mm_cvtsi32_si128(b_shift));
+            v = _mm_or_si128(_mm_or_si128(a, g), _mm_or_si128(r, b));
+            _mm_storeu_si128((__m128i*)dest, v);
+        }
+
+        dest += 4;
+        length -= 4;
+    }
+
+    while (length) {
+        *dest = unpremultiply_pixel(*dest, table, swapRB);
+        dest++;
+        length--;
+    }
+}
+
 // dest = color + (dest * alpha)
 inline static void copy_helper_sse2(uint32_t* dest, int length,
                                          uint32_t color, uint32_t alpha)
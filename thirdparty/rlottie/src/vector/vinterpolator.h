@@ -47,6 +47,10 @@ public:
 
     float value(float aX) const;
 
+    // control points the curve was built from.
+    VPointF outTangent() const { return VPointF(mX1, mY1); }
+    VPointF inTangent() const { return VPointF(mX2, mY2); }
+
     void GetSplineDerivativeValues(float aX, float& aDX, float& aDY) const;
 
 private:
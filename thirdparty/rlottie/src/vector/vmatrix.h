@@ -41,6 +41,12 @@ public:
         Project = 0x10
     };
     VMatrix() = default;
+    VMatrix(float m11, float m12, float m13, float m21, float m22, float m23,
+            float mtx, float mty, float m33)
+        : m11(m11), m12(m12), m13(m13), m21(m21), m22(m22), m23(m23),
+          mtx(mtx), mty(mty), m33(m33), dirty(MatrixType::Project)
+    {
+    }
     bool         isAffine() const;
     bool         isIdentity() const;
     bool         isInvertible() const;
@@ -34,6 +34,8 @@ void VPainter::drawRle(const VPoint &, const VRle &rle)
 
     if (!mSpanData.mUnclippedBlendFunc) return;
 
+    addDirtyRect(rle.boundingRect());
+
     // do draw after applying clip.
     rle.intersect(mSpanData.clipRect(), mSpanData.mUnclippedBlendFunc,
                   &mSpanData);
@@ -45,15 +47,25 @@ void VPainter::drawRle(const VRle &rle, const VRle &clip)
 
     if (!mSpanData.mUnclippedBlendFunc) return;
 
-    rle.intersect(clip, mSpanData.mUnclippedBlendFunc, &mSpanData);
+    VRect bounds = rle.boundingRect() & clip.boundingRect();
+    addDirtyRect(bounds);
+
+    if (mSpanData.clipRect().contains(bounds)) {
+        rle.intersect(clip, mSpanData.mUnclippedBlendFunc, &mSpanData);
+    } else {
+        // the clip rect cuts through, keep to it.
+        rle.intersect(mSpanData.clipRect() & clip,
+                      mSpanData.mUnclippedBlendFunc, &mSpanData);
+    }
 }
 
 static void fillRect(const VRect &r, VSpanData *data)
 {
-    auto x1 = std::max(r.x(), 0);
-    auto x2 = std::min(r.x() + r.width(), data->mDrawableSize.width());
-    auto y1 = std::max(r.y(), 0);
-    auto y2 = std::min(r.y() + r.height(), data->mDrawableSize.height());
+    VRect clip = data->clipRect();
+    auto  x1 = std::max(r.x(), clip.left());
+    auto  x2 = std::min(r.x() + r.width(), clip.right());
+    auto  y1 = std::max(r.y(), clip.top());
+    auto  y2 = std::min(r.y() + r.height(), clip.bottom());
 
     if (x2 <= x1 || y2 <= y1) return;
 
@@ -89,6 +101,7 @@ void VPainter::drawBitmapUntransform(const VRect &  target,
 
     VRect rr = source.translated(target.x(), target.y());
 
+    addDirtyRect(rr);
     fillRect(rr, &mSpanData);
 }
 
@@ -100,10 +113,20 @@ bool VPainter::begin(VBitmap *buffer)
 {
     mBuffer.prepare(buffer);
     mSpanData.init(&mBuffer);
+    mDirtyRect = VRect();
     // TODO find a better api to clear the surface
     mBuffer.clear();
     return true;
 }
+
+bool VPainter::begin(VBitmap *buffer, const VRect &clearRect)
+{
+    mBuffer.prepare(buffer);
+    mSpanData.init(&mBuffer);
+    mDirtyRect = VRect();
+    mBuffer.clear(clearRect);
+    return true;
+}
 void VPainter::end() {}
 
 void VPainter::setDrawRegion(const VRect &region)
@@ -111,6 +134,11 @@ void VPainter::setDrawRegion(const VRect &region)
     mSpanData.setDrawRegion(region);
 }
 
+void VPainter::setClipRect(const VRect &rect)
+{
+    mSpanData.setClipRect(rect);
+}
+
 void VPainter::setBrush(const VBrush &brush)
 {
     mSpanData.setup(brush);
@@ -126,6 +154,21 @@ VRect VPainter::clipBoundingRect() const
     return mSpanData.clipRect();
 }
 
+VRect VPainter::drawRect() const
+{
+    return mSpanData.drawRect();
+}
+
+void VPainter::addDirtyRect(const VRect &rect)
+{
+    mDirtyRect = mDirtyRect.united(rect & mSpanData.clipRect());
+}
+
+VRect VPainter::dirtyRect() const
+{
+    return mDirtyRect.translated(mSpanData.mOffset.x(), mSpanData.mOffset.y());
+}
+
 void VPainter::drawBitmap(const VPoint &point, const VBitmap &bitmap,
                           const VRect &source, uint8_t const_alpha)
 {
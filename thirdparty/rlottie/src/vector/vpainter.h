@@ -36,13 +36,21 @@ public:
     VPainter() = default;
     explicit VPainter(VBitmap *buffer);
     bool  begin(VBitmap *buffer);
+    // only clears clearRect, the rest of the buffer must be transparent.
+    bool  begin(VBitmap *buffer, const VRect &clearRect);
     void  end();
     void  setDrawRegion(const VRect &region); // sub surface rendering area.
+    // limits drawing to a part of the draw region, in its coordinates.
+    void  setClipRect(const VRect &rect);
     void  setBrush(const VBrush &brush);
     void  setBlendMode(BlendMode mode);
     void  drawRle(const VPoint &pos, const VRle &rle);
     void  drawRle(const VRle &rle, const VRle &clip);
     VRect clipBoundingRect() const;
+    // the whole draw region in its own coordinates, the clip lies within.
+    VRect drawRect() const;
+    // bounding rect (in buffer coordinates) of everything drawn since begin.
+    VRect dirtyRect() const;
 
     void  drawBitmap(const VPoint &point, const VBitmap &bitmap, const VRect &source, uint8_t const_alpha = 255);
     void  drawBitmap(const VRect &target, const VBitmap &bitmap, const VRect &source, uint8_t const_alpha = 255);
@@ -51,8 +59,10 @@ public:
 private:
     void drawBitmapUntransform(const VRect &target, const VBitmap &bitmap,
                                const VRect &source, uint8_t const_alpha);
+    void addDirtyRect(const VRect &rect);
     VRasterBuffer mBuffer;
     VSpanData     mSpanData;
+    VRect         mDirtyRect;
 };
 
 V_END_NAMESPACE
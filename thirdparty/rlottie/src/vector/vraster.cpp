@@ -20,9 +20,13 @@
  * SOFTWARE.
  */
 #include "vraster.h"
+#include <algorithm>
+#include <atomic>
 #include <climits>
+#include <condition_variable>
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include "config.h"
 #include "v_ft_raster.h"
 #include "v_ft_stroker.h"
@@ -30,6 +34,7 @@
 #include "vmatrix.h"
 #include "vpath.h"
 #include "vrle.h"
+#include "vtaskscheduler.h"
 
 V_BEGIN_NAMESPACE
 
@@ -78,7 +83,7 @@ public:
     SW_FT_Fixed             ftMiterLimit;
     dyn_array<SW_FT_Vector> mPointMemory{100};
     dyn_array<char>         mTagMemory{100};
-    dyn_array<short>        mContourMemory{10};
+    dyn_array<int>          mContourMemory{10};
     dyn_array<char>         mContourFlagMemory{10};
 };
 
@@ -171,7 +176,7 @@ void FTOutline::convert(CapStyle cap, JoinStyle join, float width,
 
 void FTOutline::moveTo(const VPointF &pt)
 {
-    assert(ft.n_points <= SHRT_MAX - 1);
+    assert(ft.n_points <= INT_MAX - 1);
 
     ft.points[ft.n_points].x = TO_FT_COORD(pt.x());
     ft.points[ft.n_points].y = TO_FT_COORD(pt.y());
@@ -189,7 +194,7 @@ void FTOutline::moveTo(const VPointF &pt)
 
 void FTOutline::lineTo(const VPointF &pt)
 {
-    assert(ft.n_points <= SHRT_MAX - 1);
+    assert(ft.n_points <= INT_MAX - 1);
 
     ft.points[ft.n_points].x = TO_FT_COORD(pt.x());
     ft.points[ft.n_points].y = TO_FT_COORD(pt.y());
@@ -200,7 +205,7 @@ void FTOutline::lineTo(const VPointF &pt)
 void FTOutline::cubicTo(const VPointF &cp1, const VPointF &cp2,
                         const VPointF ep)
 {
-    assert(ft.n_points <= SHRT_MAX - 3);
+    assert(ft.n_points <= INT_MAX - 3);
 
     ft.points[ft.n_points].x = TO_FT_COORD(cp1.x());
     ft.points[ft.n_points].y = TO_FT_COORD(cp1.y());
@@ -219,7 +224,7 @@ void FTOutline::cubicTo(const VPointF &cp1, const VPointF &cp2,
 }
 void FTOutline::close()
 {
-    assert(ft.n_points <= SHRT_MAX - 1);
+    assert(ft.n_points <= INT_MAX - 1);
 
     // mark the contour as a close path.
     ft.contours_flag[ft.n_contours] = 0;
@@ -245,7 +250,7 @@ void FTOutline::close()
 
 void FTOutline::end()
 {
-    assert(ft.n_contours <= SHRT_MAX - 1);
+    assert(ft.n_contours <= INT_MAX - 1);
 
     if (ft.n_points) {
         ft.contours[ft.n_contours] = ft.n_points - 1;
@@ -276,18 +281,29 @@ public:
             std::lock_guard<std::mutex> lock(_mutex);
             _ready = true;
         }
-        _cv.notify_one();
+        _cv.notify_all();
     }
+    // several tiles of a frame can wait for the same rle.
     void wait()
     {
-        if (!_pending) return;
+        if (!_pending.load(std::memory_order_acquire)) return;
 
         {
+            // give the workers what this thread collected so far.
+            VRasterBatch::flushCurrent();
+
             std::unique_lock<std::mutex> lock(_mutex);
-            while (!_ready) _cv.wait(lock);
+            while (!_ready) {
+                // run queued work instead of blocking a pool worker, once
+                // nothing is queued our task is running somewhere.
+                lock.unlock();
+                bool helped = VTaskScheduler::instance().runPending();
+                lock.lock();
+                if (!helped && !_ready) _cv.wait(lock);
+            }
         }
 
-        _pending = false;
+        _pending.store(false, std::memory_order_release);
     }
 
     VRle &get()
@@ -296,21 +312,49 @@ public:
         return _rle;
     }
 
+    // waits for the previous request, the caller then writes the new one
+    // and arm()s it.
     void reset()
     {
         wait();
         _ready = false;
-        _pending = true;
+        _pending.store(true, std::memory_order_relaxed);
     }
 
+    // a stale queued task may claim the request from here on, so the
+    // request has to be complete before.
+    void arm() { _claimed.store(false, std::memory_order_release); }
+
+    // the thread that claims a pending request is the one running it.
+    bool claim() { return !_claimed.exchange(true, std::memory_order_acq_rel); }
+
 private:
     VRle                    _rle;
     std::mutex              _mutex;
     std::condition_variable _cv;
     bool                    _ready{true};
-    bool                    _pending{false};
+    std::atomic<bool>       _pending{false};
+    std::atomic<bool>       _claimed{true};
+};
+
+/*
+ * Outline and stroker scratch of the thread running the task, the tasks
+ * run on the shared pool as well as on threads waiting for them.
+ */
+struct RleThreadState {
+    RleThreadState() { SW_FT_Stroker_New(&stroker); }
+    ~RleThreadState() { SW_FT_Stroker_Done(stroker); }
+
+    FTOutline     outlineRef{};
+    SW_FT_Stroker stroker;
 };
 
+static RleThreadState &rleThreadState()
+{
+    static thread_local RleThreadState state;
+    return state;
+}
+
 struct VRleTask {
     SharedRle mRle;
     VPath     mPath;
@@ -322,20 +366,46 @@ struct VRleTask {
     JoinStyle mJoin;
     bool      mGenerateStroke;
 
-    VRle &rle() { return mRle.get(); }
+    VRle &rle()
+    {
+        // nobody started the request yet, run it here instead of waiting
+        // for a worker to get to it.
+        if (mRle.claim()) {
+            auto &state = rleThreadState();
+            (*this)(state.outlineRef, state.stroker);
+        }
+        return mRle.get();
+    }
+
+    // drops a request nobody started, its result is about to be replaced.
+    void cancel()
+    {
+        if (!mRle.claim()) return;
+        mPath = VPath();
+        mRle.notify();
+    }
+
+    // entry point of the workers, the request may already run elsewhere.
+    void execute(FTOutline &outRef, SW_FT_Stroker &stroker)
+    {
+        if (mRle.claim()) (*this)(outRef, stroker);
+    }
 
     void update(VPath path, FillRule fillRule, const VRect &clip)
     {
+        cancel();
         mRle.reset();
         mPath = std::move(path);
         mFillRule = fillRule;
         mClip = clip;
         mGenerateStroke = false;
+        mRle.arm();
     }
 
     void update(VPath path, CapStyle cap, JoinStyle join, float width,
                 float miterLimit, const VRect &clip)
     {
+        cancel();
         mRle.reset();
         mPath = std::move(path);
         mCap = cap;
@@ -344,6 +414,46 @@ struct VRleTask {
         mMiterLimit = miterLimit;
         mClip = clip;
         mGenerateStroke = true;
+        mRle.arm();
+    }
+
+    /*
+     * Rough relative cost of the task, only used to start the expensive
+     * ones of a batch first. Converting the outline scales with the points
+     * and scan conversion with the covered area, the stroker about triples
+     * the work on the points.
+     */
+    size_t cost() const
+    {
+        const auto &points = mPath.points();
+        if (points.empty()) return 0;
+
+        float left = points.front().x(), right = left;
+        float top = points.front().y(), bottom = top;
+        for (const auto &pt : points) {
+            left = std::min(left, pt.x());
+            right = std::max(right, pt.x());
+            top = std::min(top, pt.y());
+            bottom = std::max(bottom, pt.y());
+        }
+
+        float pointCost = 1;
+        if (mGenerateStroke) {
+            left -= mStrokeWidth;
+            right += mStrokeWidth;
+            top -= mStrokeWidth;
+            bottom += mStrokeWidth;
+            pointCost = 3;
+        }
+        if (!mClip.empty()) {
+            left = std::max(left, float(mClip.left()));
+            right = std::min(right, float(mClip.right()));
+            top = std::max(top, float(mClip.top()));
+            bottom = std::min(bottom, float(mClip.bottom()));
+        }
+        float area = std::max(0.0f, right - left) * std::max(0.0f, bottom - top);
+
+        return size_t(float(points.size()) * pointCost * 16 + area / 16);
     }
     void render(FTOutline &outRef)
     {
@@ -371,8 +481,12 @@ struct VRleTask {
 
     void operator()(FTOutline &outRef, SW_FT_Stroker &stroker)
     {
-        if (mPath.points().size() > SHRT_MAX ||
-            mPath.points().size() + mPath.segments() > SHRT_MAX) {
+        // the outline counts are ints and the stroker multiplies the points,
+        // a path this big isn't drawable anyway.
+        if (mPath.points().size() + mPath.segments() > INT_MAX / 16) {
+            mRle.unsafe().reset();
+            mPath = VPath();
+            mRle.notify();
             return;
         }
 
@@ -415,104 +529,6 @@ struct VRleTask {
 
 using VTask = std::shared_ptr<VRleTask>;
 
-#ifdef LOTTIE_THREAD_SUPPORT
-
-#include <thread>
-#include "vtaskqueue.h"
-
-class RleTaskScheduler {
-    const unsigned                _count{std::thread::hardware_concurrency()};
-    std::vector<std::thread>      _threads;
-    std::vector<TaskQueue<VTask>> _q{_count};
-    std::atomic<unsigned>         _index{0};
-
-    void run(unsigned i)
-    {
-        /*
-         * initalize  per thread objects.
-         */
-        FTOutline     outlineRef;
-        SW_FT_Stroker stroker;
-        SW_FT_Stroker_New(&stroker);
-
-        // Task Loop
-        VTask task;
-        while (true) {
-            bool success = false;
-
-            for (unsigned n = 0; n != _count * 2; ++n) {
-                if (_q[(i + n) % _count].try_pop(task)) {
-                    success = true;
-                    break;
-                }
-            }
-
-            if (!success && !_q[i].pop(task)) break;
-
-            (*task)(outlineRef, stroker);
-        }
-
-        // cleanup
-        SW_FT_Stroker_Done(stroker);
-    }
-
-    RleTaskScheduler()
-    {
-        for (unsigned n = 0; n != _count; ++n) {
-            _threads.emplace_back([&, n] { run(n); });
-        }
-    }
-
-public:
-    static RleTaskScheduler &instance()
-    {
-        static RleTaskScheduler singleton;
-        return singleton;
-    }
-
-    ~RleTaskScheduler()
-    {
-        for (auto &e : _q) e.done();
-
-        for (auto &e : _threads) e.join();
-    }
-
-    void process(VTask task)
-    {
-        auto i = _index++;
-
-        for (unsigned n = 0; n != _count; ++n) {
-            if (_q[(i + n) % _count].try_push(std::move(task))) return;
-        }
-
-        if (_count > 0) {
-            _q[i % _count].push(std::move(task));
-        }
-    }
-};
-
-#else
-
-class RleTaskScheduler {
-public:
-    FTOutline     outlineRef{};
-    SW_FT_Stroker stroker;
-
-public:
-    static RleTaskScheduler &instance()
-    {
-        static RleTaskScheduler singleton;
-        return singleton;
-    }
-
-    RleTaskScheduler() { SW_FT_Stroker_New(&stroker); }
-
-    ~RleTaskScheduler() { SW_FT_Stroker_Done(stroker); }
-
-    void process(VTask task) { (*task)(outlineRef, stroker); }
-};
-#endif
-
 struct VRasterizer::VRasterizerImpl {
     VRleTask mTask;
 
@@ -531,16 +547,76 @@ void VRasterizer::init()
     if (!d) d = std::make_shared<VRasterizerImpl>();
 }
 
+static thread_local VRasterBatch *tCurrentBatch = nullptr;
+
+VRasterBatch::VRasterBatch() : mPrevious(tCurrentBatch)
+{
+    tCurrentBatch = this;
+}
+
+VRasterBatch::~VRasterBatch()
+{
+    flush();
+    tCurrentBatch = mPrevious;
+}
+
+void VRasterBatch::flush()
+{
+    if (mRequests.empty()) return;
+
+    // longest first, so the last task of a frame tends to be a short one.
+    if (mRequests.size() > 1) {
+        std::vector<std::pair<size_t, size_t>> costs;
+        costs.reserve(mRequests.size());
+        for (size_t i = 0; i < mRequests.size(); i++)
+            costs.emplace_back(mRequests[i]->task().cost(), i);
+        std::stable_sort(costs.begin(), costs.end(),
+                         [](const std::pair<size_t, size_t> &a,
+                            const std::pair<size_t, size_t> &b) {
+                             return a.first > b.first;
+                         });
+
+        decltype(mRequests) sorted;
+        sorted.reserve(mRequests.size());
+        for (const auto &e : costs)
+            sorted.push_back(std::move(mRequests[e.second]));
+        mRequests = std::move(sorted);
+    }
+
+    size_t count = mRequests.size();
+    VTaskScheduler::instance().processBatch(
+        count, [requests = std::move(mRequests)](size_t i) {
+            auto &state = rleThreadState();
+            requests[i]->task().execute(state.outlineRef, state.stroker);
+        });
+    mRequests.clear();
+}
+
+void VRasterBatch::flushCurrent()
+{
+    for (auto batch = tCurrentBatch; batch; batch = batch->mPrevious)
+        batch->flush();
+}
+
 void VRasterizer::updateRequest()
 {
+    if (tCurrentBatch) {
+        tCurrentBatch->mRequests.push_back(d);
+        return;
+    }
+
     VTask taskObj = VTask(d, &d->task());
-    RleTaskScheduler::instance().process(std::move(taskObj));
+    VTaskScheduler::instance().process([taskObj] {
+        auto &state = rleThreadState();
+        taskObj->execute(state.outlineRef, state.stroker);
+    });
 }
 
 void VRasterizer::rasterize(VPath path, FillRule fillRule, const VRect &clip)
 {
     init();
     if (path.empty()) {
+        d->task().cancel();
         d->rle().reset();
         return;
     }
@@ -553,6 +629,7 @@ void VRasterizer::rasterize(VPath path, CapStyle cap, JoinStyle join,
 {
     init();
     if (path.empty() || vIsZero(width)) {
+        d->task().cancel();
         d->rle().reset();
         return;
     }
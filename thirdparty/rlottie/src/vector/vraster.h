@@ -23,6 +23,7 @@
 #ifndef VRASTER_H
 #define VRASTER_H
 #include <future>
+#include <vector>
 #include "vglobal.h"
 #include "vrect.h"
 
@@ -39,12 +40,33 @@ public:
                    float miterLimit, const VRect &clip = VRect());
     VRle rle();
 private:
+    friend class VRasterBatch;
     struct VRasterizerImpl;
     void init();
     void updateRequest();
     std::shared_ptr<VRasterizerImpl> d{nullptr};
 };
 
+/*
+ * Collects the rasterization requests made on this thread while it is alive
+ * and queues them as one batch, instead of one task per request.
+ */
+class VRasterBatch
+{
+public:
+    VRasterBatch();
+    ~VRasterBatch();
+    VRasterBatch(const VRasterBatch &) = delete;
+    VRasterBatch &operator=(const VRasterBatch &) = delete;
+
+    void flush();
+    static void flushCurrent();
+private:
+    friend class VRasterizer;
+    VRasterBatch *                                            mPrevious;
+    std::vector<std::shared_ptr<VRasterizer::VRasterizerImpl>> mRequests;
+};
+
 V_END_NAMESPACE
 
 #endif  // VRASTER_H
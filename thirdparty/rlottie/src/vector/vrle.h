@@ -42,6 +42,7 @@ public:
     using VRleSpanCb = void (*)(size_t count, const VRle::Span *spans,
                                 void *userData);
     bool  empty() const { return d->empty(); }
+    size_t spanCount() const { return d->mSpans.size(); }
     VRect boundingRect() const { return d->bbox(); }
     void  setBoundingRect(const VRect &bbox) { d->setBbox(bbox); }
     void  addSpan(const VRle::Span *span, size_t count)
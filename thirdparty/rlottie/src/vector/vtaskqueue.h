@@ -23,65 +23,123 @@
 #ifndef VTASKQUEUE_H
 #define VTASKQUEUE_H
 
-#include <deque>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
+/*
+ * Chase-Lev work stealing deque (Le et al, "Correct and Efficient
+ * Work-Stealing for Weak Memory Models"), with the fences folded into
+ * sequentially consistent accesses of top and bottom.
+ * Only the owner thread calls push() and pop() and works LIFO on the
+ * bottom end, any other thread may steal() FIFO from the top end.
+ * Task has to be trivially copyable (a pointer), the slots are read by
+ * thieves while the owner writes them.
+ */
 template <typename Task>
-class TaskQueue {
-    using lock_t = std::unique_lock<std::mutex>;
-    std::deque<Task>      _q;
-    bool                    _done{false};
-    std::mutex              _mutex;
-    std::condition_variable _ready;
+class TaskDeque {
+    struct Array {
+        explicit Array(int64_t capacity)
+            : mCapacity(capacity), mSlots(new std::atomic<Task>[capacity])
+        {
+        }
+
+        Task get(int64_t i) const
+        {
+            return mSlots[i & (mCapacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t i, Task task)
+        {
+            mSlots[i & (mCapacity - 1)].store(task, std::memory_order_relaxed);
+        }
+
+        int64_t                             mCapacity;
+        std::unique_ptr<std::atomic<Task>[]> mSlots;
+    };
+
+    std::atomic<int64_t>                mTop{0};
+    std::atomic<int64_t>                mBottom{0};
+    std::atomic<Array *>                mArray;
+    // thieves may still read an array after it was replaced, so they are
+    // only freed with the deque.
+    std::vector<std::unique_ptr<Array>> mArrays;
 
 public:
-    bool try_pop(Task &task)
+    explicit TaskDeque(int64_t capacity = 64)
     {
-        lock_t lock{_mutex, std::try_to_lock};
-        if (!lock || _q.empty()) return false;
-        task = std::move(_q.front());
-        _q.pop_front();
-        return true;
+        mArrays.emplace_back(new Array(capacity));
+        mArray.store(mArrays.back().get(), std::memory_order_relaxed);
     }
 
-    bool try_push(Task &&task)
+    TaskDeque(const TaskDeque &) = delete;
+    TaskDeque &operator=(const TaskDeque &) = delete;
+
+    bool empty() const
     {
-        {
-            lock_t lock{_mutex, std::try_to_lock};
-            if (!lock) return false;
-            _q.push_back(std::move(task));
-        }
-        _ready.notify_one();
-        return true;
+        int64_t b = mBottom.load(std::memory_order_relaxed);
+        int64_t t = mTop.load(std::memory_order_relaxed);
+        return b <= t;
     }
 
-    void done()
+    void push(Task task)
     {
-        {
-            lock_t lock{_mutex};
-            _done = true;
+        int64_t b = mBottom.load(std::memory_order_relaxed);
+        int64_t t = mTop.load(std::memory_order_acquire);
+        Array * a = mArray.load(std::memory_order_relaxed);
+        if (b - t > a->mCapacity - 1) {
+            auto grown = std::make_unique<Array>(a->mCapacity * 2);
+            for (int64_t i = t; i != b; ++i) grown->put(i, a->get(i));
+            a = grown.get();
+            mArrays.push_back(std::move(grown));
+            mArray.store(a, std::memory_order_release);
         }
-        _ready.notify_all();
+        a->put(b, task);
+        mBottom.store(b + 1, std::memory_order_release);
     }
 
     bool pop(Task &task)
     {
-        lock_t lock{_mutex};
-        while (_q.empty() && !_done) _ready.wait(lock);
-        if (_q.empty()) return false;
-        task = std::move(_q.front());
-        _q.pop_front();
+        int64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+        Array * a = mArray.load(std::memory_order_relaxed);
+        mBottom.store(b, std::memory_order_seq_cst);
+        int64_t t = mTop.load(std::memory_order_seq_cst);
+
+        if (t > b) {
+            mBottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        task = a->get(b);
+        if (t == b) {
+            // last item, race the thieves for it.
+            bool won = mTop.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            mBottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
         return true;
     }
 
-    void push(Task &&task)
+    bool steal(Task &task)
     {
-        {
-            lock_t lock{_mutex};
-            _q.push_back(std::move(task));
+        while (true) {
+            int64_t t = mTop.load(std::memory_order_seq_cst);
+            int64_t b = mBottom.load(std::memory_order_seq_cst);
+            if (t >= b) return false;
+
+            Array *a = mArray.load(std::memory_order_acquire);
+            Task   item = a->get(t);
+            if (mTop.compare_exchange_strong(t, t + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                task = item;
+                return true;
+            }
+            // lost the race to another thief or the owner, try the next one.
         }
-        _ready.notify_one();
     }
-
 };
 
 #endif  // VTASKQUEUE_H
@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "vtaskscheduler.h"
+#include "config.h"
+
+#ifdef LOTTIE_THREAD_SUPPORT
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
+#include "vtaskqueue.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+ * Every worker owns a work stealing deque. Tasks queued by a worker go to
+ * its own deque and are run LIFO by it, idle workers steal the oldest ones
+ * from the others. Tasks queued by other threads go through a shared
+ * injection queue.
+ * Idle workers park on an event count: a worker announces itself as a
+ * sleeper, looks for work once more and then waits for the epoch to move,
+ * so a producer only touches the mutex when somebody sleeps.
+ * When the host provides an executor the pool has no workers, every queued
+ * task posts a job to the executor that runs whichever task is pending by
+ * then.
+ */
+struct VTaskScheduler::Pool : std::enable_shared_from_this<Pool> {
+    using Deque = TaskDeque<Task *>;
+
+    Pool(unsigned threadCount, bool pinThreads, Executor executor)
+        : mCount(executor ? 0 : std::max(1u, threadCount)),
+          mDeques(mCount),
+          mExecutor(std::move(executor))
+    {
+        for (unsigned n = 0; n != mCount; ++n) {
+            mThreads.emplace_back([this, n] { run(n); });
+            if (pinThreads) pin(mThreads.back(), n);
+        }
+    }
+
+    ~Pool()
+    {
+        shutdown();
+
+        // nothing is left in practice, but the promises of a dropped task
+        // would never be fulfilled.
+        Task *task;
+        for (auto &e : mDeques) {
+            while (e.pop(task)) execute(task);
+        }
+        while (takeInjected(task)) execute(task);
+    }
+
+    // the workers run everything queued before they leave, a task queued
+    // after that is run by the thread queuing it.
+    void shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mParkMutex);
+            mDone = true;
+        }
+        mParked.notify_all();
+
+        for (auto &e : mThreads) {
+            if (e.joinable()) e.join();
+        }
+    }
+
+    static void execute(Task *task)
+    {
+        (*task)();
+        delete task;
+    }
+
+    void run(unsigned i)
+    {
+        sWorker = this;
+        sWorkerIndex = i;
+
+        Task *task;
+        while (true) {
+            if (take(task)) {
+                execute(task);
+                continue;
+            }
+
+            unsigned epoch = mEpoch.load();
+            ++mSleepers;
+            if (take(task)) {
+                --mSleepers;
+                execute(task);
+                continue;
+            }
+            if (mDone.load()) {
+                --mSleepers;
+                while (take(task)) execute(task);
+                break;
+            }
+            {
+                std::unique_lock<std::mutex> lock(mParkMutex);
+                while (mEpoch.load() == epoch && !mDone.load())
+                    mParked.wait(lock);
+            }
+            --mSleepers;
+            mWaking.store(false);
+
+            // more work may be queued, pass the wake up on.
+            if (take(task)) {
+                wake();
+                execute(task);
+            }
+        }
+
+        sWorker = nullptr;
+    }
+
+    void push(Task &&task)
+    {
+        auto *item = new Task(std::move(task));
+        if (sWorker == this) {
+            mDeques[sWorkerIndex].push(item);
+        } else {
+            std::lock_guard<std::mutex> lock(mInjectedMutex);
+            mInjected.push_back(item);
+            ++mInjectedCount;
+        }
+
+        wake();
+
+        if (mExecutor) {
+            auto self = shared_from_this();
+            mExecutor([self] { self->runPending(); });
+        }
+
+        if (mDone.load()) {
+            Task *pending;
+            while (take(pending)) execute(pending);
+        }
+    }
+
+    struct Batch {
+        Batch(size_t count, size_t grain, BatchTask &&task)
+            : mCount(count), mGrain(grain), mTask(std::move(task))
+        {
+        }
+
+        void run()
+        {
+            size_t begin;
+            while ((begin = mNext.fetch_add(mGrain)) < mCount) {
+                size_t end = std::min(mCount, begin + mGrain);
+                for (size_t i = begin; i != end; ++i) mTask(i);
+            }
+        }
+
+        const size_t        mCount;
+        const size_t        mGrain;
+        BatchTask           mTask;
+        std::atomic<size_t> mNext{0};
+    };
+
+    // one runner per worker that can help, a few chunks each so uneven
+    // tasks still balance.
+    void pushBatch(size_t count, BatchTask &&task)
+    {
+        size_t workers = mCount;
+        if (!workers) workers = std::max(1u, std::thread::hardware_concurrency());
+        size_t grain = std::max<size_t>(1, count / (workers * 4));
+        size_t runners = std::min(workers, (count + grain - 1) / grain);
+
+        auto batch = std::make_shared<Batch>(count, grain, std::move(task));
+        for (size_t n = 0; n != runners; ++n) push([batch] { batch->run(); });
+    }
+
+    // only one wake up is in flight at a time, the woken worker passes it
+    // on once it found work, so a burst of tasks costs one notification.
+    void wake()
+    {
+        ++mEpoch;
+        if (mSleepers.load() && !mWaking.exchange(true)) {
+            { std::lock_guard<std::mutex> lock(mParkMutex); }
+            mParked.notify_one();
+        }
+    }
+
+    bool takeInjected(Task *&task)
+    {
+        if (!mInjectedCount.load()) return false;
+
+        std::lock_guard<std::mutex> lock(mInjectedMutex);
+        if (mInjected.empty()) return false;
+        task = mInjected.front();
+        mInjected.pop_front();
+        --mInjectedCount;
+        return true;
+    }
+
+    bool take(Task *&task)
+    {
+        unsigned start;
+        if (sWorker == this) {
+            if (mDeques[sWorkerIndex].pop(task)) return true;
+            start = sWorkerIndex + 1;
+        } else {
+            start = sStealIndex++;
+        }
+
+        for (unsigned n = 0; n != mCount; ++n) {
+            if (mDeques[(start + n) % mCount].steal(task)) return true;
+        }
+        return takeInjected(task);
+    }
+
+    bool runPending()
+    {
+        Task *task;
+        if (!take(task)) return false;
+
+        execute(task);
+        return true;
+    }
+
+    static void pin(std::thread &thread, unsigned n)
+    {
+#if defined(__linux__)
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(n % cores, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)n;
+#endif
+    }
+
+    static thread_local Pool *   sWorker;
+    static thread_local unsigned sWorkerIndex;
+    static thread_local unsigned sStealIndex;
+
+    const unsigned           mCount;
+    std::vector<Deque>       mDeques;
+    std::vector<std::thread> mThreads;
+    Executor                 mExecutor;
+
+    std::mutex          mInjectedMutex;
+    std::deque<Task *>  mInjected;
+    std::atomic<size_t> mInjectedCount{0};
+
+    std::mutex              mParkMutex;
+    std::condition_variable mParked;
+    std::atomic<unsigned>   mEpoch{0};
+    std::atomic<unsigned>   mSleepers{0};
+    std::atomic<bool>       mWaking{false};
+    std::atomic<bool>       mDone{false};
+};
+
+thread_local VTaskScheduler::Pool *VTaskScheduler::Pool::sWorker = nullptr;
+thread_local unsigned VTaskScheduler::Pool::sWorkerIndex = 0;
+thread_local unsigned VTaskScheduler::Pool::sStealIndex = 0;
+
+VTaskScheduler &VTaskScheduler::instance()
+{
+    static VTaskScheduler singleton;
+    return singleton;
+}
+
+VTaskScheduler::~VTaskScheduler()
+{
+    if (mPool) mPool->shutdown();
+}
+
+std::shared_ptr<VTaskScheduler::Pool> VTaskScheduler::pool()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mPool) {
+        unsigned count = mThreadCount;
+        if (!count) count = std::thread::hardware_concurrency();
+        mPool = std::make_shared<Pool>(count, mPinThreads, mExecutor);
+    }
+    return mPool;
+}
+
+/*
+ * Workers use their own pool, other threads keep a reference to the current
+ * pool and only take the lock again after the pool was replaced.
+ */
+VTaskScheduler::Pool &VTaskScheduler::current()
+{
+    if (Pool::sWorker) return *Pool::sWorker;
+
+    static thread_local std::shared_ptr<Pool> cached;
+    static thread_local unsigned              generation = 0;
+
+    unsigned latest = mGeneration.load(std::memory_order_acquire);
+    if (!cached || generation != latest) {
+        cached = pool();
+        generation = latest;
+    }
+    return *cached;
+}
+
+void VTaskScheduler::process(Task task)
+{
+    current().push(std::move(task));
+}
+
+void VTaskScheduler::processBatch(size_t count, BatchTask task)
+{
+    if (count) current().pushBatch(count, std::move(task));
+}
+
+bool VTaskScheduler::runPending()
+{
+    return current().runPending();
+}
+
+// threads holding the old pool pick up the new one on their next call, the
+// old workers finish what was queued before they leave.
+void VTaskScheduler::replace(std::shared_ptr<Pool> old)
+{
+    mGeneration.fetch_add(1, std::memory_order_release);
+    if (old) old->shutdown();
+}
+
+void VTaskScheduler::configure(unsigned threadCount, bool pinThreads)
+{
+    std::shared_ptr<Pool> old;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mThreadCount == threadCount && mPinThreads == pinThreads) return;
+        mThreadCount = threadCount;
+        mPinThreads = pinThreads;
+        old = std::move(mPool);
+    }
+    replace(std::move(old));
+}
+
+void VTaskScheduler::setExecutor(Executor executor)
+{
+    std::shared_ptr<Pool> old;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExecutor = std::move(executor);
+        old = std::move(mPool);
+    }
+    replace(std::move(old));
+}
+
+unsigned VTaskScheduler::threadCount()
+{
+    return pool()->mCount;
+}
+
+#else
+
+struct VTaskScheduler::Pool {
+};
+
+VTaskScheduler &VTaskScheduler::instance()
+{
+    static VTaskScheduler singleton;
+    return singleton;
+}
+
+VTaskScheduler::~VTaskScheduler() = default;
+
+void VTaskScheduler::process(Task task)
+{
+    task();
+}
+
+void VTaskScheduler::processBatch(size_t count, BatchTask task)
+{
+    for (size_t i = 0; i != count; ++i) task(i);
+}
+
+bool VTaskScheduler::runPending()
+{
+    return false;
+}
+
+void VTaskScheduler::configure(unsigned, bool) {}
+
+void VTaskScheduler::setExecutor(Executor) {}
+
+unsigned VTaskScheduler::threadCount()
+{
+    return 0;
+}
+
+#endif
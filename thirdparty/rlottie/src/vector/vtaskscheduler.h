@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VTASKSCHEDULER_H
+#define VTASKSCHEDULER_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+/*
+ * Thread pool shared by the render tasks of the animations and the path
+ * rasterization tasks, so the library doesn't create a pool per task kind.
+ * The pool can also hand the work over to an executor of the host
+ * application.
+ */
+class VTaskScheduler {
+public:
+    using Task = std::function<void()>;
+    using BatchTask = std::function<void(size_t)>;
+    using Executor = std::function<void(Task)>;
+
+    static VTaskScheduler &instance();
+
+    void process(Task task);
+
+    // queues task(0) ... task(count - 1) at once, the workers claim them in
+    // chunks in ascending order.
+    void processBatch(size_t count, BatchTask task);
+
+    // runs one queued task on the calling thread, used by threads that wait
+    // for a task so they don't block the worker they run on.
+    bool runPending();
+
+    // 0 threads selects the number of cores.
+    void     configure(unsigned threadCount, bool pinThreads);
+    void     setExecutor(Executor executor);
+    unsigned threadCount();
+
+    ~VTaskScheduler();
+
+private:
+    struct Pool;
+
+    VTaskScheduler() = default;
+    std::shared_ptr<Pool> pool();
+    Pool &                current();
+    void                  replace(std::shared_ptr<Pool> old);
+
+    std::mutex            mMutex;
+    std::shared_ptr<Pool> mPool;
+    std::atomic<unsigned> mGeneration{0};
+    Executor              mExecutor;
+    unsigned              mThreadCount{0};
+    bool                  mPinThreads{false};
+};
+
+#endif  // VTASKSCHEDULER_H